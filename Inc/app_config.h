@@ -41,20 +41,44 @@
 /* general */
 #define NODE_ID                         2
 #define BASEBOARD                       0               /* set to 1 if the comboard will be installed on a baseboard */
-#define WAKEUP_PERIOD_S                 60              /* period at which the hello world task will run */
+#define WAKEUP_PERIOD_S                 60              /* period at which the hello world task will run (initial period if WAKEUP_PERIOD_ADAPTIVE is enabled) */
+#define WAKEUP_PERIOD_ADAPTIVE          0               /* if enabled, adjust the wakeup period to the BOLT traffic: halve it when messages were received, stretch it by 25% when idle */
+#define WAKEUP_PERIOD_MIN_S             10              /* lower bound for the adaptive wakeup period */
+#define WAKEUP_PERIOD_MAX_S             300             /* upper bound for the adaptive wakeup period (note: also delays the BOLT polling and the TREQ watchdog checks) */
 #define LOW_POWER_MODE                  LP_MODE_STOP2   /* low-power mode to use between rounds during periods of inactivity */
 #define LPM_DISABLE_GPIO_CLOCKS         0               /* set to 1 to disable GPIO clocks in low-power mode (-> no GPIO tracing possible) */
 #define BASEBOARD_TREQ_WATCHDOG         900             /* if != 0, the baseboard will be power-cycled if no time request has been received within the specified #seconds */
+#define RADIO_PERIPH_INIT               0               /* initialize SPI2 (radio) and TIM16 (LED PWM) at boot; this application uses neither, set to 1 if the flora lib radio driver is used */
+#define BOLT_IND_WAKEUP                 1               /* wake up the BOLT task on a rising edge of BOLT_IND (data available) instead of waiting for the next periodic round */
+#define BOLT_IND_MIN_INTERVAL_MS        1000            /* min. time between two BOLT_IND wakeups, edges within this interval defer the wakeup to the end of the interval */
 
 /* timesync */
 #define TIMESTAMP_TYPICAL_DRIFT_PPM     40    /* typical drift +/- in ppm (if exceeded, a warning will be issued) */
 #define TIMESTAMP_MAX_DRIFT_PPM         100   /* max. allowed drift in ppm (higher values will be capped) */
+#define TIMESYNC_DRIFT_ESTIMATOR        DRIFT_ESTIMATOR_LSQ   /* drift estimation method (see drift_estimator.h) */
+#define DRIFT_ESTIMATOR_WINDOW          8     /* number of sync points used for the least-squares drift estimation */
+#define TIMESYNC_TREQ_HW_CAPTURE        1     /* latch the COM_TREQ edge with TIM2_CH4 input capture; only effective if the MCU is awake when the edge occurs (TIM2 stops in STOP2, the EXTI timestamp with lptimer resolution is used then), costs a busy-wait of up to one lptimer tick in the ISR */
+#define TIMESYNC_SYNC_ERROR_US          50    /* uncertainty of a sync point in us (timestamp resolution and capture delay) */
+#define TIMESYNC_DRIFT_ERROR_PPB        1000  /* uncertainty of an estimated or learned drift in ppb */
+#define HOLDOVER_ENABLE                 1     /* predict the drift from the MCU temperature if no sync points are received */
+#define HOLDOVER_TIMEOUT_S              900   /* enter holdover mode if no sync point has been received within this time */
+#define HOLDOVER_TEMP_INTERVAL_S        60    /* temperature measurement interval in holdover mode */
+#define DRIFT_TEMP_BIN_WIDTH            5     /* width of the temperature bins for the learned drift, in degrees C */
+#define TIMESYNC_TREQ_LATENCY_TEST_US   0     /* for testing only: if != 0, a random delay of up to the given #us is inserted before the timestamp is taken and the error of the capture methods is logged */
+
+/* message processing */
+#define CRC16_IMPL                      CRC16_IMPL_SLICE4   /* CRC16 implementation used for DPP messages (see crc.h) */
+#define MSG_HDR_CRC_RESUME              1     /* precalculate the CRC over the constant header fields of each message type and resume from it when sending */
+#define CRC16_SELFTEST                  0     /* verify the CRC16 implementation against the flora lib crc16() at startup (falls back to crc16() on mismatch), for debugging only */
 
 /* memory */
 #define BOLT_TASK_STACK_SIZE            256   /* in # words of 4 bytes */
 #define TIMESYNC_TASK_STACK_SIZE        256   /* in # words of 4 bytes */
 #define HELLOWORLD_TASK_STACK_SIZE      256   /* in # words of 4 bytes */
-#define COMMAND_QUEUE_SIZE              10    /* queue size for baseboard enable/disable commands */
+#define STACK_USAGE_WARNING_THRESHOLD   80    /* print a warning if the stack usage of a task or the main stack reaches this value, in percent */
+#define COMMAND_QUEUE_SIZE              16    /* max. number of pending scheduled baseboard enable/disable commands (the app processor schedules a few enable/disable pairs ahead), RAM usage is ~COMMAND_QUEUE_SIZE * 20 bytes */
+#define MSG_POOL_SIZE                   4     /* number of preallocated buffers for outgoing DPP messages (max. 32), RAM usage is MSG_POOL_SIZE * sizeof(dpp_message_t) */
+#define COMMAND_HANDLER_MAX_CNT         16    /* max. number of command handlers registered with COMMAND_HANDLER() */
 #define BOLT_MAX_READ_COUNT             100   /* max. number of messages to read from BOLT at once */
 
 /* Flora lib config */
@@ -67,11 +91,16 @@
 #define CLI_ENABLE                      0           /* command line interface */
 #define SWO_ENABLE                      0
 #define BOLT_ENABLE                     1
+#define BOLT_USE_DMA                    1           /* use the SPI1 DMA channels for BOLT transfers (one completion interrupt per message instead of one interrupt per byte) */
 #define NVCFG_ENABLE                    1
 
 /* logging */
 #define LOG_ENABLE                      1
 #define LOG_LEVEL                       LOG_LEVEL_VERBOSE
+#define BOOT_TRACE_ENABLE               1           /* measure and print the duration of each init stage in main() */
+#define TRACE_ENABLE                    0           /* record tracepoints (DWT cycle counter) into a RAM ring buffer and print them in each periodic round, decode with tools/trace_decode.py */
+#define TRACE_BUFFER_SIZE               256         /* number of trace entries (power of 2), RAM usage is 8 bytes per entry */
+#define LOG_TASK_STATS                  1           /* print the CPU time share of each task and the ISRs in each periodic round (also enables the FreeRTOS run-time stats and trace facility) */
 #define LOG_PRINT_IMMEDIATELY           1           /* if set to zero, the debug task is responsible for printing out the debug messages via UART */
 #if BASEBOARD
   #define LOG_ADD_TIMESTAMP             0           /* don't print the timestamp on the baseboard */
@@ -86,6 +115,10 @@
 #define CPU_OFF_IND()                   //PIN_CLR(COM_PROG)
 #define LPM_ON_IND()                    //PIN_CLR(COM_PROG)
 #define LPM_OFF_IND()                   //PIN_SET(COM_PROG)
+#if LOG_TASK_STATS || TRACE_ENABLE
+  #define ISR_ON_IND()                  rtos_isr_enter()
+  #define ISR_OFF_IND()                 rtos_isr_exit()
+#endif /* LOG_TASK_STATS || TRACE_ENABLE */
 
 
 /* --- parameter checks --- */
@@ -94,6 +127,46 @@
 #error "BOLT_MAX_MSG_LEN is too small"
 #endif
 
+#if WAKEUP_PERIOD_ADAPTIVE && ((WAKEUP_PERIOD_MIN_S == 0) || (WAKEUP_PERIOD_MIN_S > WAKEUP_PERIOD_S) || (WAKEUP_PERIOD_S > WAKEUP_PERIOD_MAX_S))
+#error "invalid wakeup period bounds"
+#endif
+
+#if BOLT_IND_WAKEUP && !BOLT_ENABLE
+#error "BOLT_IND_WAKEUP requires BOLT_ENABLE"
+#endif
+
+#if TRACE_ENABLE && (TRACE_BUFFER_SIZE & (TRACE_BUFFER_SIZE - 1))
+#error "TRACE_BUFFER_SIZE must be a power of 2"
+#endif
+
+#if TIMESYNC_TREQ_LATENCY_TEST_US && !TIMESYNC_TREQ_HW_CAPTURE
+#error "TIMESYNC_TREQ_LATENCY_TEST_US requires TIMESYNC_TREQ_HW_CAPTURE"
+#endif
+
+#if DRIFT_TEMP_BIN_WIDTH == 0
+#error "DRIFT_TEMP_BIN_WIDTH must not be 0"
+#endif
+
+#if DRIFT_ESTIMATOR_WINDOW < 2
+#error "DRIFT_ESTIMATOR_WINDOW must be at least 2"
+#endif
+
+#if COMMAND_QUEUE_SIZE == 0 || COMMAND_QUEUE_SIZE > 32767
+#error "invalid COMMAND_QUEUE_SIZE"
+#endif
+
+#if MSG_POOL_SIZE == 0 || MSG_POOL_SIZE > 32
+#error "MSG_POOL_SIZE must be between 1 and 32"
+#endif
+
+#if COMMAND_HANDLER_MAX_CNT >= 255
+#error "COMMAND_HANDLER_MAX_CNT must be < 255"
+#endif
+
+#if CRC16_IMPL < CRC16_IMPL_BITWISE || CRC16_IMPL > CRC16_IMPL_HW
+#error "invalid CRC16_IMPL"
+#endif
+
 #if BASEBOARD_TREQ_WATCHDOG > 0 && BASEBOARD_TREQ_WATCHDOG < 120
 #error "BASEBOARD_TREQ_WATCHDOG must be >= 120"
 #endif
@@ -0,0 +1,61 @@
+/*
+ * Copyright (c) 2022, ETH Zurich, Computer Engineering Group (TEC)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef __BOOT_TRACE_H
+#define __BOOT_TRACE_H
+
+
+/* --- definitions --- */
+
+#ifndef BOOT_TRACE_ENABLE
+#define BOOT_TRACE_ENABLE       0
+#endif /* BOOT_TRACE_ENABLE */
+
+#define BOOT_TRACE_MAX_STAGES   24      /* max. number of recorded init stages */
+
+#if BOOT_TRACE_ENABLE
+  #define BOOT_TRACE_START()    boot_trace_start()
+  #define BOOT_TRACE(stage)     boot_trace_mark(stage)      /* marks the end of an init stage */
+  #define BOOT_TRACE_PRINT()    boot_trace_print()
+#else
+  #define BOOT_TRACE_START()
+  #define BOOT_TRACE(stage)
+  #define BOOT_TRACE_PRINT()
+#endif /* BOOT_TRACE_ENABLE */
+
+
+/* --- function prototypes --- */
+
+void boot_trace_start(void);                  /* resets the DWT cycle counter, must be called at the very beginning of main() */
+void boot_trace_mark(const char* stage);
+void boot_trace_print(void);                  /* prints the duration of each stage */
+
+
+#endif /* __BOOT_TRACE_H */
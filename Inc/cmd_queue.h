@@ -0,0 +1,57 @@
+/*
+ * Copyright (c) 2022, ETH Zurich, Computer Engineering Group (TEC)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef __CMD_QUEUE_H
+#define __CMD_QUEUE_H
+
+
+/* --- definitions --- */
+
+#define CMD_QUEUE_ID_INVALID    0
+
+
+/* --- typedefs --- */
+
+typedef struct {
+  dpp_command_type_t  type;
+  uint16_t            arg;
+  uint32_t            scheduled_time;
+  uint16_t            id;             /* assigned by cmd_queue_add() */
+} scheduled_cmd_t;
+
+
+/* --- function prototypes --- */
+
+uint16_t                cmd_queue_add(dpp_command_type_t type, uint16_t arg, uint32_t scheduled_time);   /* returns the command ID or CMD_QUEUE_ID_INVALID if the queue is full */
+const scheduled_cmd_t*  cmd_queue_peek(void);                                   /* command with the earliest scheduled time or NULL */
+bool                    cmd_queue_pop(scheduled_cmd_t* out_cmd);                /* removes the command with the earliest scheduled time */
+
+
+#endif /* __CMD_QUEUE_H */
@@ -0,0 +1,50 @@
+/*
+ * Copyright (c) 2022, ETH Zurich, Computer Engineering Group (TEC)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef __CRC_H
+#define __CRC_H
+
+
+/* --- definitions --- */
+
+#define CRC16_IMPL_BITWISE    0     /* crc16() from the flora lib, bit by bit */
+#define CRC16_IMPL_TABLE      1     /* byte-wise table lookup (512 bytes of flash) */
+#define CRC16_IMPL_SLICE4     2     /* slice-by-4 table lookup (2kB of flash) */
+#define CRC16_IMPL_SLICE8     3     /* slice-by-8 table lookup (4kB of flash) */
+#define CRC16_IMPL_HW         4     /* hardware CRC unit */
+
+
+/* --- function prototypes --- */
+
+void      crc16_init(void);
+uint16_t  crc16_fast(const uint8_t* data, uint16_t num_bytes, uint16_t init_value);   /* same result as crc16() */
+
+
+#endif /* __CRC_H */
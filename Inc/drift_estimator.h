@@ -0,0 +1,50 @@
+/*
+ * Copyright (c) 2022, ETH Zurich, Computer Engineering Group (TEC)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef __DRIFT_ESTIMATOR_H
+#define __DRIFT_ESTIMATOR_H
+
+
+/* --- definitions --- */
+
+#define DRIFT_ESTIMATOR_PAIRWISE    0     /* drift between the last two sync points, averaged with the previous estimate */
+#define DRIFT_ESTIMATOR_LSQ         1     /* least-squares fit of the clock skew over the last DRIFT_ESTIMATOR_WINDOW sync points */
+
+
+/* --- function prototypes --- */
+
+void      drift_estimator_reset(void);                                    /* discards all sync points, keeps the current estimate */
+bool      drift_estimator_add_sample(uint64_t local_ticks, uint64_t unix_time_us);   /* returns true if the estimate has been updated */
+int32_t   drift_estimator_get_drift_ppb(void);                            /* drift of the local timer towards the time master, in ppb (positive = local clock runs fast) */
+void      drift_estimator_learn_temp(int32_t temp, int32_t ppb);         /* stores the drift estimate for the given temperature in degrees C (ignores TEMP_SENSOR_INVALID) */
+bool      drift_estimator_predict(int32_t temp, int32_t* out_drift_ppb); /* predicts the drift from the learned values, returns false if nothing has been learned yet or the temperature is invalid */
+
+
+#endif /* __DRIFT_ESTIMATOR_H */
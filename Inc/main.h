@@ -36,11 +36,19 @@ extern "C" {
 /* include flora lib (also includes app_config.h) */
 #include "flora_lib.h"
 
-/* FreeRTOS files */
-#include "cmsis_os.h"
+/* FreeRTOS files (the CMSIS-OS wrapper is not used) */
+#include "FreeRTOS.h"
+#include "task.h"
 
 /* project files */
+#include "boot_trace.h"
+#include "crc.h"
+#include "drift_estimator.h"
+#include "local_clock.h"
+#include "cmd_queue.h"
 #include "message.h"
+#include "temp_sensor.h"
+#include "trace.h"
 
 /* USER CODE END Includes */
 
@@ -94,6 +102,12 @@ extern IWDG_HandleTypeDef hiwdg;
 #define MS_TO_HAL_TICKS(ms) (((ms) * HAL_GetTickFreq()) / 1000)
 #define MS_TO_RTOS_TICKS(ms)  ((ms) / portTICK_PERIOD_MS)       // = pdMS_TO_TICKS()
 
+#define CYCLE_COUNTER_ENABLE()  do { \
+                                  CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk; \
+                                  DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk; \
+                                } while (0)
+#define CYCLE_COUNTER_VALUE()   (DWT->CYCCNT)                   /* note: does not run in STOP modes */
+
 
 /* USER CODE END EM */
 
@@ -106,11 +120,21 @@ void Error_Handler(void);
 
 uint64_t  get_time(uint64_t at_time);           /* returns the UNIX time in us at the given local time in ticks; if the argument is 0, the current timestamp is used */
 void      set_time(uint64_t unix_time_us);      /* set a UNIX timestamp */
+uint64_t  get_local_time(uint64_t unix_time_us);  /* returns the local time in lptimer ticks at which the given UNIX time (in us) will be reached */
+uint32_t  get_time_uncertainty(uint64_t at_time); /* returns the max. error of get_time() in us, UINT32_MAX if the time has not been set */
 
 void      rtos_init(void);
 uint32_t  rtos_get_cpu_dc(void);     /* get duty cycle in [% * 10^2] */
 void      rtos_reset_cpu_dc(void);   /* reset duty cycle */
-uint32_t  rtos_check_stack_usage(void);
+void      rtos_isr_enter(void);
+void      rtos_isr_exit(void);
+void      rtos_log_task_stats(void); /* print the CPU time share of each task and the ISRs since the last call */
+uint32_t  rtos_check_stack_usage(void);    /* prints the stack high-water marks, returns the max. stack usage in percent */
+void      rtos_paint_main_stack(void);
+
+uint32_t  bolt_get_read_cnt(bool reset);     /* number of messages read from BOLT since the last reset */
+bool      helloworld_round_active(void);     /* true while the hello world task is in a round, OP_MODE_EVT_DONE must not be signaled by other tasks */
+void      helloworld_request_wakeup(uint64_t timestamp);   /* requests a round of the hello world task (polls BOLT) at the given local clock timestamp, ISR safe */
 
 void      notify_com_task(com_task_notify_t val, bool overwrite, bool from_isr);
 void      get_radio_stats(int8_t* out_avg_rssi, uint8_t* out_avg_snr, uint8_t* out_avg_hops, bool reset_stats);
@@ -126,7 +150,6 @@ uint64_t  get_reference_timestamp(void);
 #define BOLT_IND_GPIO_Port GPIOA
 #define COM_TREQ_Pin GPIO_PIN_3
 #define COM_TREQ_GPIO_Port GPIOA
-#define COM_TREQ_EXTI_IRQn EXTI3_IRQn
 #define APP_IND_Pin GPIO_PIN_4
 #define APP_IND_GPIO_Port GPIOA
 #define BOLT_SCK_Pin GPIO_PIN_5
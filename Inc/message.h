@@ -34,29 +34,48 @@
 
 /* --- definitions --- */
 
+/* registers a command handler at compile time, the entry is placed in the .cmd_handlers flash section */
+#define COMMAND_HANDLER(cmd_type, func) \
+  static const cmd_handler_t cmd_handler_##cmd_type __attribute__((section(".cmd_handlers"), used)) = { cmd_type, func }
 
-/* --- typedefs --- */
 
-typedef struct {
-  dpp_command_type_t  type;
-  uint16_t            arg;
-  uint32_t            scheduled_time;
-} scheduled_cmd_t;
+/* --- typedefs --- */
 
 typedef struct {
   uint32_t starttime;
   uint32_t period;
 } periodic_t;
 
+typedef bool (*cmd_handler_func_t)(const dpp_command_t* cmd, const dpp_header_t* hdr);
+
+typedef struct {
+  dpp_command_type_t  type;
+  cmd_handler_func_t  handler;
+} cmd_handler_t;
+
+typedef struct {
+  uint32_t count;         /* number of invocations */
+  uint32_t max_cycles;    /* max. execution time in CPU cycles */
+  uint64_t cycles;        /* total execution time in CPU cycles */
+} cmd_stats_t;
+
 
 /* --- function prototypes --- */
 
 bool      process_command(const dpp_command_t* cmd, const dpp_header_t* hdr);
-bool      process_message(dpp_message_t* msg, bool rcvd_from_bolt);
+void      log_command_stats(void);
+bool      validate_message(const dpp_message_t* msg, uint32_t rcvd_len);
+bool      process_validated_message(dpp_message_t* msg, bool rcvd_from_bolt);
 void      process_scheduled_commands(void);
-bool      send_message(dpp_message_type_t type);
+dpp_message_t* msg_pool_acquire(void);
+void      msg_pool_release(dpp_message_t* msg);
+uint32_t  msg_pool_get_free_min(void);
+bool      send_message(dpp_message_t* msg, dpp_message_type_t type);
+uint32_t  send_queued_messages(void);
+void      log_msg_queue_stats(void);
 void      generate_command(dpp_command_type_t cmd, uint16_t arg);
 bool      schedule_command(uint32_t sched_time, dpp_command_type_t cmd_type, uint16_t arg);
+uint32_t  get_next_command_time(void);     /* UNIX time in seconds of the next scheduled command or periodic baseboard enable, 0 if none */
 uint32_t  get_next_timestamp_at_daytime(time_t curr_time, uint32_t hour, uint32_t minute, uint32_t second);
 
 
@@ -53,7 +53,8 @@ void MemManage_Handler(void);
 void BusFault_Handler(void);
 void UsageFault_Handler(void);
 void DebugMon_Handler(void);
-void EXTI3_IRQHandler(void);
+void DMA1_Channel2_IRQHandler(void);
+void DMA1_Channel3_IRQHandler(void);
 void DMA1_Channel4_IRQHandler(void);
 void DMA1_Channel5_IRQHandler(void);
 void TIM1_UP_TIM16_IRQHandler(void);
@@ -65,7 +66,8 @@ void EXTI15_10_IRQHandler(void);
 void RTC_Alarm_IRQHandler(void);
 void LPTIM1_IRQHandler(void);
 /* USER CODE BEGIN EFP */
-
+void EXTI0_IRQHandler(void);
+void EXTI3_IRQHandler(void);
 /* USER CODE END EFP */
 
 #ifdef __cplusplus
@@ -0,0 +1,79 @@
+/*
+ * Copyright (c) 2022, ETH Zurich, Computer Engineering Group (TEC)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef __TRACE_H
+#define __TRACE_H
+
+
+/* --- definitions --- */
+
+#ifndef TRACE_ENABLE
+#define TRACE_ENABLE            0
+#endif /* TRACE_ENABLE */
+
+#ifndef TRACE_BUFFER_SIZE
+#define TRACE_BUFFER_SIZE       256       /* number of entries in the ring buffer, must be a power of 2 */
+#endif /* TRACE_BUFFER_SIZE */
+
+#define TRACE_TYPE_BEGIN        0
+#define TRACE_TYPE_END          1
+
+#if TRACE_ENABLE
+  #define TRACE_BEGIN(id)       trace_record(id, TRACE_TYPE_BEGIN)
+  #define TRACE_END(id)         trace_record(id, TRACE_TYPE_END)
+  #define TRACE_ISR_BEGIN()     trace_record(TRACE_ID_ISR_BASE + (__get_IPSR() & 0xff), TRACE_TYPE_BEGIN)
+  #define TRACE_ISR_END()       trace_record(TRACE_ID_ISR_BASE + (__get_IPSR() & 0xff), TRACE_TYPE_END)
+#else
+  #define TRACE_BEGIN(id)
+  #define TRACE_END(id)
+  #define TRACE_ISR_BEGIN()
+  #define TRACE_ISR_END()
+#endif /* TRACE_ENABLE */
+
+
+/* --- typedefs --- */
+
+/* tracepoint IDs, keep in sync with tools/trace_decode.py */
+typedef enum {
+  TRACE_ID_PROCESS_MSG = 1,
+  TRACE_ID_SEND_MSG    = 2,
+  TRACE_ID_BOLT_READ   = 3,
+  TRACE_ID_UPDATE_TIME = 4,
+  TRACE_ID_ISR_BASE    = 16,      /* ISRs: TRACE_ID_ISR_BASE + exception number */
+} trace_id_t;
+
+
+/* --- function prototypes --- */
+
+void trace_record(uint32_t id, uint32_t type);      /* ISR safe */
+void trace_dump(void);                              /* prints and clears the recorded entries */
+
+
+#endif /* __TRACE_H */
@@ -0,0 +1,101 @@
+/*
+ * Copyright (c) 2022, ETH Zurich, Computer Engineering Group (TEC)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * boot time profiler
+ *
+ * Records the DWT cycle counter and the current core clock at the end of each
+ * init stage in main(). The duration of a stage is calculated with the core
+ * clock at the beginning of the stage, i.e. stages that change the system
+ * clock (SystemClock_Config) are an approximation. The time from reset to
+ * main() (startup code) is not included.
+ */
+
+#include "main.h"
+
+
+#if BOOT_TRACE_ENABLE
+
+/* Private typedefs ----------------------------------------------------------*/
+
+typedef struct {
+  const char* name;
+  uint32_t    cycles;         /* cycle counter value at the end of the stage */
+  uint32_t    clock_hz;       /* core clock at the end of the stage */
+} boot_stage_t;
+
+
+/* Private variables ---------------------------------------------------------*/
+
+static boot_stage_t boot_stages[BOOT_TRACE_MAX_STAGES];
+static uint32_t     boot_stage_cnt  = 0;
+static uint32_t     boot_start_clock_hz;
+
+
+/* Functions -----------------------------------------------------------------*/
+
+void boot_trace_start(void)
+{
+  CYCLE_COUNTER_ENABLE();
+  DWT->CYCCNT         = 0;      /* not cleared by a system reset */
+  boot_stage_cnt      = 0;
+  boot_start_clock_hz = SystemCoreClock;
+}
+
+
+void boot_trace_mark(const char* stage)
+{
+  if (boot_stage_cnt < BOOT_TRACE_MAX_STAGES) {
+    boot_stages[boot_stage_cnt].cycles   = CYCLE_COUNTER_VALUE();
+    boot_stages[boot_stage_cnt].clock_hz = SystemCoreClock;
+    boot_stages[boot_stage_cnt].name     = stage;
+    boot_stage_cnt++;
+  }
+}
+
+
+void boot_trace_print(void)
+{
+  uint32_t prev_cycles = 0;
+  uint32_t clock_mhz   = boot_start_clock_hz / 1000000;
+  uint32_t total_us    = 0;
+
+  LOG_INFO("boot trace:");
+  for (uint32_t i = 0; i < boot_stage_cnt; i++) {
+    uint32_t duration_us = (boot_stages[i].cycles - prev_cycles) / (clock_mhz ? clock_mhz : 1);
+    LOG_INFO("  %-20s %8luus", boot_stages[i].name, duration_us);
+    total_us   += duration_us;
+    prev_cycles = boot_stages[i].cycles;
+    clock_mhz   = boot_stages[i].clock_hz / 1000000;
+  }
+  LOG_INFO("  %-20s %8luus", "total", total_us);
+}
+
+#endif /* BOOT_TRACE_ENABLE */
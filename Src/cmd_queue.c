@@ -0,0 +1,250 @@
+/*
+ * Copyright (c) 2022, ETH Zurich, Computer Engineering Group (TEC)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * queue for scheduled (baseboard) commands
+ *
+ * The pending commands are stored in a fixed pool. A binary min-heap of pool
+ * indices orders them by the scheduled time, i.e. the next command to execute
+ * is always at the root. Commands with the same scheduled time are executed in
+ * the order they were added (the ID is used as a tie-breaker).
+ * Adding an identical command (same type, argument and scheduled time) as one
+ * that is already pending returns the ID of the pending command instead of
+ * adding a duplicate. The pending commands are indexed by an open addressing
+ * hash table for this check, so that an insert remains O(log n).
+ */
+
+#include "main.h"
+
+
+#if BASEBOARD
+
+/* Private define ------------------------------------------------------------*/
+
+#define CMD_QUEUE_PARENT(i)     (((i) - 1) / 2)
+#define CMD_QUEUE_LEFT(i)       (2 * (i) + 1)
+#define CMD_QUEUE_HASH_SIZE     (2 * COMMAND_QUEUE_SIZE + 1)      /* load factor <= 0.5 */
+#define CMD_QUEUE_HASH_EMPTY    0xffff
+
+
+/* Private variables ---------------------------------------------------------*/
+
+static scheduled_cmd_t  cmd_pool[COMMAND_QUEUE_SIZE];
+static uint16_t         cmd_pool_free[COMMAND_QUEUE_SIZE];          /* stack of free pool indices */
+static uint32_t         cmd_pool_free_cnt = 0;
+static bool             cmd_pool_init     = false;
+static uint16_t         cmd_heap[COMMAND_QUEUE_SIZE];               /* pool indices */
+static uint32_t         cmd_heap_cnt      = 0;
+static uint16_t         cmd_hash[CMD_QUEUE_HASH_SIZE];              /* pool indices, CMD_QUEUE_HASH_EMPTY = empty slot */
+static uint16_t         cmd_next_id       = CMD_QUEUE_ID_INVALID + 1;
+
+
+/* Private functions ---------------------------------------------------------*/
+
+static void cmd_queue_init(void)
+{
+  for (uint32_t i = 0; i < COMMAND_QUEUE_SIZE; i++) {
+    cmd_pool_free[i] = COMMAND_QUEUE_SIZE - 1 - i;
+  }
+  cmd_pool_free_cnt = COMMAND_QUEUE_SIZE;
+  for (uint32_t i = 0; i < CMD_QUEUE_HASH_SIZE; i++) {
+    cmd_hash[i] = CMD_QUEUE_HASH_EMPTY;
+  }
+  cmd_pool_init = true;
+}
+
+
+static uint32_t cmd_queue_hash(dpp_command_type_t type, uint16_t arg, uint32_t scheduled_time)
+{
+  return ((scheduled_time * 2654435761UL) ^ ((uint32_t)type << 16) ^ arg) % CMD_QUEUE_HASH_SIZE;
+}
+
+
+/* returns the hash table slot of the given command or the empty slot where it would be inserted */
+static uint32_t cmd_queue_hash_find(dpp_command_type_t type, uint16_t arg, uint32_t scheduled_time)
+{
+  uint32_t slot = cmd_queue_hash(type, arg, scheduled_time);
+
+  while (cmd_hash[slot] != CMD_QUEUE_HASH_EMPTY) {
+    const scheduled_cmd_t* cmd = &cmd_pool[cmd_hash[slot]];
+    if (cmd->scheduled_time == scheduled_time && cmd->type == type && cmd->arg == arg) {
+      break;
+    }
+    slot = (slot + 1) % CMD_QUEUE_HASH_SIZE;
+  }
+  return slot;
+}
+
+
+/* removes a pool entry from the hash table (backward shift deletion, no tombstones needed) */
+static void cmd_queue_hash_remove(uint16_t pool_idx)
+{
+  const scheduled_cmd_t* cmd = &cmd_pool[pool_idx];
+  uint32_t               gap = cmd_queue_hash_find(cmd->type, cmd->arg, cmd->scheduled_time);
+  uint32_t               slot = gap;
+
+  for (;;) {
+    cmd_hash[gap] = CMD_QUEUE_HASH_EMPTY;
+    do {
+      slot = (slot + 1) % CMD_QUEUE_HASH_SIZE;
+      if (cmd_hash[slot] == CMD_QUEUE_HASH_EMPTY) {
+        return;
+      }
+      cmd = &cmd_pool[cmd_hash[slot]];
+      uint32_t home = cmd_queue_hash(cmd->type, cmd->arg, cmd->scheduled_time);
+      /* the entry can only be moved into the gap if its home slot is not cyclically in (gap, slot] */
+      if ((gap < slot) ? ((home <= gap) || (home > slot)) : ((home <= gap) && (home > slot))) {
+        break;
+      }
+    } while (1);
+    cmd_hash[gap] = cmd_hash[slot];
+    gap = slot;
+  }
+}
+
+
+/* returns true if command a is due before command b */
+static bool cmd_queue_before(uint16_t a, uint16_t b)
+{
+  if (cmd_pool[a].scheduled_time != cmd_pool[b].scheduled_time) {
+    return cmd_pool[a].scheduled_time < cmd_pool[b].scheduled_time;
+  }
+  /* same time -> insertion order (IDs are assigned in increasing order, consider wrap-around) */
+  return (int16_t)(cmd_pool[a].id - cmd_pool[b].id) < 0;
+}
+
+
+static void cmd_queue_sift_up(uint32_t idx)
+{
+  uint16_t cmd = cmd_heap[idx];
+
+  while (idx > 0 && cmd_queue_before(cmd, cmd_heap[CMD_QUEUE_PARENT(idx)])) {
+    cmd_heap[idx] = cmd_heap[CMD_QUEUE_PARENT(idx)];
+    idx = CMD_QUEUE_PARENT(idx);
+  }
+  cmd_heap[idx] = cmd;
+}
+
+
+static void cmd_queue_sift_down(uint32_t idx)
+{
+  uint16_t cmd = cmd_heap[idx];
+
+  while (CMD_QUEUE_LEFT(idx) < cmd_heap_cnt) {
+    uint32_t child = CMD_QUEUE_LEFT(idx);
+    if ((child + 1 < cmd_heap_cnt) && cmd_queue_before(cmd_heap[child + 1], cmd_heap[child])) {
+      child++;
+    }
+    if (!cmd_queue_before(cmd_heap[child], cmd)) {
+      break;
+    }
+    cmd_heap[idx] = cmd_heap[child];
+    idx = child;
+  }
+  cmd_heap[idx] = cmd;
+}
+
+
+/* removes the element at the given heap index */
+static void cmd_queue_remove(uint32_t idx)
+{
+  uint16_t pool_idx = cmd_heap[idx];
+
+  cmd_queue_hash_remove(pool_idx);
+  cmd_pool_free[cmd_pool_free_cnt++] = pool_idx;
+  cmd_heap_cnt--;
+  if (idx == cmd_heap_cnt) {
+    return;     /* last element */
+  }
+  /* move the last element into the gap and restore the heap property */
+  cmd_heap[idx] = cmd_heap[cmd_heap_cnt];
+  if (idx > 0 && cmd_queue_before(cmd_heap[idx], cmd_heap[CMD_QUEUE_PARENT(idx)])) {
+    cmd_queue_sift_up(idx);
+  } else {
+    cmd_queue_sift_down(idx);
+  }
+}
+
+
+/* Functions -----------------------------------------------------------------*/
+
+uint16_t cmd_queue_add(dpp_command_type_t type, uint16_t arg, uint32_t scheduled_time)
+{
+  if (!cmd_pool_init) {
+    cmd_queue_init();
+  }
+  /* drop duplicates */
+  uint32_t slot = cmd_queue_hash_find(type, arg, scheduled_time);
+  if (cmd_hash[slot] != CMD_QUEUE_HASH_EMPTY) {
+    return cmd_pool[cmd_hash[slot]].id;
+  }
+  if (cmd_pool_free_cnt == 0) {
+    return CMD_QUEUE_ID_INVALID;
+  }
+  uint16_t id = cmd_next_id++;
+  if (cmd_next_id == CMD_QUEUE_ID_INVALID) {
+    cmd_next_id++;
+  }
+  uint16_t pool_idx = cmd_pool_free[--cmd_pool_free_cnt];
+  cmd_pool[pool_idx].type           = type;
+  cmd_pool[pool_idx].arg            = arg;
+  cmd_pool[pool_idx].scheduled_time = scheduled_time;
+  cmd_pool[pool_idx].id             = id;
+  cmd_hash[slot] = pool_idx;
+  cmd_heap[cmd_heap_cnt] = pool_idx;
+  cmd_heap_cnt++;
+  cmd_queue_sift_up(cmd_heap_cnt - 1);
+
+  return id;
+}
+
+
+const scheduled_cmd_t* cmd_queue_peek(void)
+{
+  if (cmd_heap_cnt == 0) {
+    return 0;
+  }
+  return &cmd_pool[cmd_heap[0]];
+}
+
+
+bool cmd_queue_pop(scheduled_cmd_t* out_cmd)
+{
+  if (cmd_heap_cnt == 0) {
+    return false;
+  }
+  if (out_cmd) {
+    *out_cmd = cmd_pool[cmd_heap[0]];
+  }
+  cmd_queue_remove(0);
+  return true;
+}
+
+#endif /* BASEBOARD */
@@ -0,0 +1,267 @@
+/*
+ * Copyright (c) 2022, ETH Zurich, Computer Engineering Group (TEC)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * drift estimation for the local timer (lptimer) based on sync points
+ *
+ * Each sync point is a pair of a local timestamp (lptimer ticks) and the
+ * corresponding UNIX timestamp of the time master (us). A sync point is rejected
+ * if the drift towards the previous sync point exceeds TIMESTAMP_MAX_DRIFT_PPM.
+ * After DRIFT_ESTIMATOR_MAX_REJECT consecutive rejections, the window is
+ * restarted (e.g. after the master time has been corrected).
+ *
+ * The least-squares estimator fits a line through the offset between the local
+ * and the master time (in us) over the local elapsed time (in ms) of all sync
+ * points in the window. The slope is in us/ms, i.e. 1 us/ms = 1000 ppm = 10^6 ppb.
+ *
+ * For the holdover mode, the estimates are averaged per temperature bin of
+ * DRIFT_TEMP_BIN_WIDTH degrees. The learned values are kept when the window is
+ * restarted. The prediction uses the bin of the given temperature, or the
+ * closest learned bin if the bin is empty.
+ */
+
+#include "main.h"
+
+
+/* Private define ------------------------------------------------------------*/
+
+#define DRIFT_ESTIMATOR_MAX_REJECT      3
+#define DRIFT_ESTIMATOR_MAX_INTERVAL_US 100000000000LL      /* max. time between two sync points (~28h), the window is restarted if exceeded */
+#define DRIFT_ESTIMATOR_MAX_PPB         (TIMESTAMP_MAX_DRIFT_PPM * 1000L)
+#define DRIFT_ESTIMATOR_TYPICAL_PPB     (TIMESTAMP_TYPICAL_DRIFT_PPM * 1000L)
+
+#define DRIFT_TEMP_MIN                  -40
+#define DRIFT_TEMP_MAX                  85
+#define DRIFT_TEMP_BINS                 ((DRIFT_TEMP_MAX - DRIFT_TEMP_MIN) / DRIFT_TEMP_BIN_WIDTH + 1)
+#define DRIFT_TEMP_AVG_CNT              8         /* number of estimates after which the bin average turns into an exponential moving average */
+
+#define TICKS_TO_US(ticks)              ((int64_t)(ticks) * 1000000 / LPTIMER_SECOND)
+#define TICKS_TO_MS(ticks)              ((int64_t)(ticks) * 1000 / LPTIMER_SECOND)
+
+
+/* Private typedefs ----------------------------------------------------------*/
+
+typedef struct {
+  uint64_t local_ticks;
+  uint64_t unix_time_us;
+} sync_point_t;
+
+
+/* Private variables ---------------------------------------------------------*/
+
+static sync_point_t sync_points[DRIFT_ESTIMATOR_WINDOW];
+static uint32_t     sync_point_cnt = 0;
+static uint32_t     sync_point_wr  = 0;       /* index of the next sync point to write */
+static uint32_t     reject_cnt     = 0;
+static int32_t      drift_ppb      = 0;
+static int32_t      temp_drift_ppb[DRIFT_TEMP_BINS];
+static uint8_t      temp_drift_cnt[DRIFT_TEMP_BINS];    /* number of estimates per bin (saturates at DRIFT_TEMP_AVG_CNT) */
+
+
+/* Private functions ---------------------------------------------------------*/
+
+static uint32_t get_temp_bin(int32_t temp)
+{
+  if (temp < DRIFT_TEMP_MIN) {
+    temp = DRIFT_TEMP_MIN;
+  } else if (temp > DRIFT_TEMP_MAX) {
+    temp = DRIFT_TEMP_MAX;
+  }
+  return (temp - DRIFT_TEMP_MIN) / DRIFT_TEMP_BIN_WIDTH;
+}
+
+
+static const sync_point_t* get_sync_point(uint32_t age)     /* age 0 = latest */
+{
+  return &sync_points[(sync_point_wr + DRIFT_ESTIMATOR_WINDOW - 1 - age) % DRIFT_ESTIMATOR_WINDOW];
+}
+
+
+#if TIMESYNC_DRIFT_ESTIMATOR == DRIFT_ESTIMATOR_LSQ
+
+static bool estimate_drift_lsq(int32_t* out_drift_ppb)
+{
+  const sync_point_t* first = get_sync_point(sync_point_cnt - 1);
+  int64_t             x[DRIFT_ESTIMATOR_WINDOW];      /* local elapsed time since the first sync point, in ms */
+  int64_t             e[DRIFT_ESTIMATOR_WINDOW];      /* local minus master elapsed time, in us */
+  int64_t             sum_x = 0;
+  int64_t             sum_e = 0;
+
+  for (uint32_t i = 0; i < sync_point_cnt; i++) {
+    const sync_point_t* sp = get_sync_point(i);
+    uint64_t            local_elapsed = sp->local_ticks - first->local_ticks;
+    x[i]   = TICKS_TO_MS(local_elapsed);
+    e[i]   = TICKS_TO_US(local_elapsed) - (int64_t)(sp->unix_time_us - first->unix_time_us);
+    sum_x += x[i];
+    sum_e += e[i];
+  }
+  int64_t mean_x = sum_x / (int64_t)sync_point_cnt;
+  int64_t mean_e = sum_e / (int64_t)sync_point_cnt;
+  int64_t s_xx   = 0;
+  int64_t s_xe   = 0;
+  for (uint32_t i = 0; i < sync_point_cnt; i++) {
+    s_xx += (x[i] - mean_x) * (x[i] - mean_x);
+    s_xe += (x[i] - mean_x) * (e[i] - mean_e);
+  }
+  /* scale down the covariance and the variance to avoid an overflow in the multiplication below */
+  while ((s_xe > (INT64_MAX / 1000000)) || (s_xe < -(INT64_MAX / 1000000))) {
+    s_xe /= 2;
+    s_xx /= 2;
+  }
+  if (s_xx <= 0) {
+    return false;
+  }
+  *out_drift_ppb = (int32_t)(s_xe * 1000000 / s_xx);
+
+  return true;
+}
+
+#endif /* TIMESYNC_DRIFT_ESTIMATOR */
+
+
+/* Functions -----------------------------------------------------------------*/
+
+void drift_estimator_reset(void)
+{
+  sync_point_cnt = 0;
+  sync_point_wr  = 0;
+  reject_cnt     = 0;
+}
+
+
+bool drift_estimator_add_sample(uint64_t local_ticks, uint64_t unix_time_us)
+{
+  int32_t pair_drift_ppb = 0;
+
+  if (sync_point_cnt) {
+    const sync_point_t* prev = get_sync_point(0);
+    int64_t master_diff_us   = (int64_t)(unix_time_us - prev->unix_time_us);
+    int64_t local_diff_us    = TICKS_TO_US(local_ticks - prev->local_ticks);
+
+    if ((master_diff_us <= 0) || (master_diff_us > DRIFT_ESTIMATOR_MAX_INTERVAL_US) || (local_diff_us <= 0)) {
+      LOG_WARNING("invalid sync point interval, drift estimation restarted");
+      drift_estimator_reset();
+
+    } else {
+      int64_t drift = (local_diff_us - master_diff_us) * 1000000000LL / master_diff_us;
+      if ((drift >= DRIFT_ESTIMATOR_MAX_PPB) || (drift <= -DRIFT_ESTIMATOR_MAX_PPB)) {
+        LOG_WARNING("drift is too large (%ldppm)", (int32_t)(drift / 1000));
+        if (++reject_cnt < DRIFT_ESTIMATOR_MAX_REJECT) {
+          return false;
+        }
+        LOG_WARNING("drift estimation restarted");
+        drift_estimator_reset();
+      } else {
+        if ((drift > DRIFT_ESTIMATOR_TYPICAL_PPB) || (drift < -DRIFT_ESTIMATOR_TYPICAL_PPB)) {
+          LOG_WARNING("drift is larger than usual");
+        }
+        pair_drift_ppb = (int32_t)drift;
+        reject_cnt     = 0;
+      }
+    }
+  }
+
+  /* store the sync point */
+  sync_points[sync_point_wr].local_ticks  = local_ticks;
+  sync_points[sync_point_wr].unix_time_us = unix_time_us;
+  sync_point_wr = (sync_point_wr + 1) % DRIFT_ESTIMATOR_WINDOW;
+  if (sync_point_cnt < DRIFT_ESTIMATOR_WINDOW) {
+    sync_point_cnt++;
+  }
+  if (sync_point_cnt < 2) {
+    return false;
+  }
+
+#if TIMESYNC_DRIFT_ESTIMATOR == DRIFT_ESTIMATOR_LSQ
+  int32_t estimate;
+  if (!estimate_drift_lsq(&estimate)) {
+    return false;
+  }
+  drift_ppb = estimate;
+#else
+  if (drift_ppb == 0) {
+    drift_ppb = pair_drift_ppb;
+  } else {
+    drift_ppb = (drift_ppb + pair_drift_ppb) / 2;
+  }
+#endif /* TIMESYNC_DRIFT_ESTIMATOR */
+
+  /* make sure the drift does not exceed the maximum allowed value */
+  if (drift_ppb > DRIFT_ESTIMATOR_MAX_PPB) {
+    drift_ppb = DRIFT_ESTIMATOR_MAX_PPB;
+  } else if (drift_ppb < -DRIFT_ESTIMATOR_MAX_PPB) {
+    drift_ppb = -DRIFT_ESTIMATOR_MAX_PPB;
+  }
+  LOG_VERBOSE("current drift: %ldppb   estimated drift: %ldppb", pair_drift_ppb, drift_ppb);
+
+  return true;
+}
+
+
+int32_t drift_estimator_get_drift_ppb(void)
+{
+  return drift_ppb;
+}
+
+
+void drift_estimator_learn_temp(int32_t temp, int32_t ppb)
+{
+  if (temp == TEMP_SENSOR_INVALID) {
+    return;
+  }
+  uint32_t bin = get_temp_bin(temp);
+
+  if (temp_drift_cnt[bin] < DRIFT_TEMP_AVG_CNT) {
+    temp_drift_cnt[bin]++;
+  }
+  temp_drift_ppb[bin] += (ppb - temp_drift_ppb[bin]) / (int32_t)temp_drift_cnt[bin];
+}
+
+
+bool drift_estimator_predict(int32_t temp, int32_t* out_drift_ppb)
+{
+  if (temp == TEMP_SENSOR_INVALID) {
+    return false;
+  }
+  int32_t bin = get_temp_bin(temp);
+
+  /* search the closest learned bin */
+  for (int32_t dist = 0; dist < DRIFT_TEMP_BINS; dist++) {
+    if ((bin - dist >= 0) && temp_drift_cnt[bin - dist]) {
+      *out_drift_ppb = temp_drift_ppb[bin - dist];
+      return true;
+    }
+    if ((bin + dist < DRIFT_TEMP_BINS) && temp_drift_cnt[bin + dist]) {
+      *out_drift_ppb = temp_drift_ppb[bin + dist];
+      return true;
+    }
+  }
+  return false;
+}
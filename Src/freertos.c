@@ -25,7 +25,6 @@
 
 /* Private includes ----------------------------------------------------------*/
 /* USER CODE BEGIN Includes */     
-#include "cmsis_os.h"
 
 /* USER CODE END Includes */
 
@@ -36,6 +35,8 @@
 
 /* Private define ------------------------------------------------------------*/
 /* USER CODE BEGIN PD */
+#define RTOS_MAX_TASK_CNT   8       /* max. number of tasks considered in the task statistics */
+#define RTOS_STACK_PATTERN  0xa5a5a5a5  /* fill pattern for the main stack to determine its high-water mark */
 
 /* USER CODE END PD */
 
@@ -62,11 +63,45 @@ TaskHandle_t xTaskHandle_helloworld  = NULL;
 TaskHandle_t xTaskHandle_timesync    = NULL;
 TaskHandle_t xTaskHandle_idle        = NULL;
 
+/* RTOS task control blocks and stacks (statically allocated -> RAM usage is known at link time) */
+#if BOLT_ENABLE
+static StaticTask_t xTaskTCB_bolt;
+static StackType_t  xTaskStack_bolt[BOLT_TASK_STACK_SIZE];
+#endif /* BOLT_ENABLE */
+static StaticTask_t xTaskTCB_helloworld;
+static StackType_t  xTaskStack_helloworld[HELLOWORLD_TASK_STACK_SIZE];
+static StaticTask_t xTaskTCB_timesync;
+static StackType_t  xTaskStack_timesync[TIMESYNC_TASK_STACK_SIZE];
+
 /* Variables */
 uint64_t active_time      = 0;
 uint64_t wakeup_timestamp = 0;
 uint64_t last_reset       = 0;
 
+#if LOG_TASK_STATS
+/* ISR time accounting */
+static volatile uint32_t isr_nesting    = 0;
+static uint32_t          isr_start      = 0;      /* cycle counter value at the start of the outermost ISR */
+static uint64_t          isr_cycles     = 0;      /* total number of cycles spent in ISRs */
+#endif /* LOG_TASK_STATS */
+
+/* configured stack size of each task, in words */
+static const struct {
+  TaskHandle_t* handle;
+  uint32_t      size;
+} rtos_task_stack_size[] = {
+#if BOLT_ENABLE
+  { &xTaskHandle_bolt,        BOLT_TASK_STACK_SIZE },
+#endif /* BOLT_ENABLE */
+  { &xTaskHandle_timesync,    TIMESYNC_TASK_STACK_SIZE },
+  { &xTaskHandle_helloworld,  HELLOWORLD_TASK_STACK_SIZE },
+  { &xTaskHandle_idle,        configMINIMAL_STACK_SIZE },
+};
+
+/* linker symbols */
+extern uint32_t _estack;
+extern uint32_t _Min_Stack_Size;
+
 /* USER CODE END Variables */
 
 /* Private function prototypes -----------------------------------------------*/
@@ -86,7 +121,27 @@ void PostSleepProcessing(uint32_t *ulExpectedIdleTime);
 /* Hook prototypes */
 void vApplicationIdleHook(void);
 void vApplicationStackOverflowHook(xTaskHandle xTask, signed char *pcTaskName);
-void vApplicationMallocFailedHook(void);
+
+/* Hook prototypes */
+void configureTimerForRunTimeStats(void);
+unsigned long getRunTimeCounterValue(void);
+
+/* USER CODE BEGIN 1 */
+/* Functions needed when configGENERATE_RUN_TIME_STATS is on */
+void configureTimerForRunTimeStats(void)
+{
+  /* the lptimer is already running */
+}
+
+unsigned long getRunTimeCounterValue(void)
+{
+  /* lptimer keeps running in STOP mode -> sleep time is accounted to the idle task */
+  return (unsigned long)local_clock_now();
+}
+/* USER CODE END 1 */
+
+/* GetIdleTaskMemory prototype (linked to static allocation support) */
+void vApplicationGetIdleTaskMemory( StaticTask_t **ppxIdleTaskTCBBuffer, StackType_t **ppxIdleTaskStackBuffer, uint32_t *pulIdleTaskStackSize );
 
 /* USER CODE BEGIN 2 */
 void vApplicationIdleHook( void )
@@ -129,22 +184,18 @@ void vApplicationStackOverflowHook(xTaskHandle xTask, signed char *pcTaskName)
 }
 /* USER CODE END 4 */
 
-/* USER CODE BEGIN 5 */
-void vApplicationMallocFailedHook(void)
+/* USER CODE BEGIN GET_IDLE_TASK_MEMORY */
+static StaticTask_t xIdleTaskTCBBuffer;
+static StackType_t xIdleStack[configMINIMAL_STACK_SIZE];
+
+void vApplicationGetIdleTaskMemory( StaticTask_t **ppxIdleTaskTCBBuffer, StackType_t **ppxIdleTaskStackBuffer, uint32_t *pulIdleTaskStackSize )
 {
-   /* vApplicationMallocFailedHook() will only be called if
-   configUSE_MALLOC_FAILED_HOOK is set to 1 in FreeRTOSConfig.h. It is a hook
-   function that will get called if a call to pvPortMalloc() fails.
-   pvPortMalloc() is called internally by the kernel whenever a task, queue,
-   timer or semaphore is created. It is also called by various parts of the
-   demo application. If heap_1.c or heap_2.c are used, then the size of the
-   heap available to pvPortMalloc() is defined by configTOTAL_HEAP_SIZE in
-   FreeRTOSConfig.h, and the xPortGetFreeHeapSize() API function can be used
-   to query the size of free heap space that remains (although it does not
-   provide information on how the remaining heap might be fragmented). */
-  FATAL_ERROR("--- malloc failed ---\r\n");
+  *ppxIdleTaskTCBBuffer = &xIdleTaskTCBBuffer;
+  *ppxIdleTaskStackBuffer = &xIdleStack[0];
+  *pulIdleTaskStackSize = configMINIMAL_STACK_SIZE;
+  /* place for user code */
 }
-/* USER CODE END 5 */
+/* USER CODE END GET_IDLE_TASK_MEMORY */
 
 /* USER CODE BEGIN PREPOSTSLEEP */
 void PreSleepProcessing(uint32_t *ulExpectedIdleTime)
@@ -153,14 +204,14 @@ void PreSleepProcessing(uint32_t *ulExpectedIdleTime)
   lpm_prepare();
 
   /* duty cycle measurement */
-  active_time += lptimer_now() - wakeup_timestamp;
+  active_time += local_clock_now() - wakeup_timestamp;
   CPU_OFF_IND();
 }
 
 void PostSleepProcessing(uint32_t *ulExpectedIdleTime)
 {
   CPU_ON_IND();
-  wakeup_timestamp = lptimer_now();    /* reset duty cycle timer */
+  wakeup_timestamp = local_clock_now();    /* reset duty cycle timer */
 
   lpm_resume();
 }
@@ -174,30 +225,33 @@ void rtos_init(void)
   /* create RTOS tasks */
   /* max. priority is (configMAX_PRIORITIES - 1), higher numbers = higher priority; idle task has priority 0 */
 #if BOLT_ENABLE
-  if (xTaskCreate(task_bolt,
-                  "boltTask",
-                  BOLT_TASK_STACK_SIZE,
-                  NULL,
-                  tskIDLE_PRIORITY + 1,
-                  &xTaskHandle_bolt) != pdPASS) { Error_Handler(); }
+  xTaskHandle_bolt       = xTaskCreateStatic(task_bolt,
+                                             "boltTask",
+                                             BOLT_TASK_STACK_SIZE,
+                                             NULL,
+                                             tskIDLE_PRIORITY + 1,
+                                             xTaskStack_bolt,
+                                             &xTaskTCB_bolt);
 #endif /* BOLT_ENABLE */
-  if (xTaskCreate(task_timesync,
-                  "timesyncTask",
-                  TIMESYNC_TASK_STACK_SIZE,
-                  NULL,
-                  tskIDLE_PRIORITY + 1,
-                  &xTaskHandle_timesync) != pdPASS) { Error_Handler(); }
-  if (xTaskCreate(task_helloworld,
-                  "helloworldTask",
-                  HELLOWORLD_TASK_STACK_SIZE,
-                  NULL,
-                  tskIDLE_PRIORITY + 1,
-                  &xTaskHandle_helloworld) != pdPASS) { Error_Handler(); }
+  xTaskHandle_timesync   = xTaskCreateStatic(task_timesync,
+                                             "timesyncTask",
+                                             TIMESYNC_TASK_STACK_SIZE,
+                                             NULL,
+                                             tskIDLE_PRIORITY + 1,
+                                             xTaskStack_timesync,
+                                             &xTaskTCB_timesync);
+  xTaskHandle_helloworld = xTaskCreateStatic(task_helloworld,
+                                             "helloworldTask",
+                                             HELLOWORLD_TASK_STACK_SIZE,
+                                             NULL,
+                                             tskIDLE_PRIORITY + 1,
+                                             xTaskStack_helloworld,
+                                             &xTaskTCB_helloworld);
 }
 
 uint32_t rtos_get_cpu_dc(void)
 {
-  uint32_t elapsed = (lptimer_now() - last_reset);
+  uint32_t elapsed = (local_clock_now() - last_reset);
   if (elapsed > 0) {
     return (uint32_t)((active_time * 10000) / elapsed);
   }
@@ -206,10 +260,129 @@ uint32_t rtos_get_cpu_dc(void)
 
 void rtos_reset_cpu_dc(void)
 {
-  last_reset = lptimer_now();
+  last_reset = local_clock_now();
   active_time = 0;
 }
 
+/* fills the unused part of the main stack with a pattern, must be called at the very beginning of main() */
+void rtos_paint_main_stack(void)
+{
+  uint32_t* addr = (uint32_t*)((uint32_t)&_estack - (uint32_t)&_Min_Stack_Size);
+  uint32_t* sp   = (uint32_t*)__get_MSP() - 16;      /* leave some margin for the current stack frame */
+
+  while (addr < sp) {
+    *addr++ = RTOS_STACK_PATTERN;
+  }
+}
+
+/* returns the max. number of bytes used on the main stack (only valid if rtos_paint_main_stack() was called) */
+static uint32_t rtos_get_main_stack_usage(void)
+{
+  const uint32_t* addr = (const uint32_t*)((uint32_t)&_estack - (uint32_t)&_Min_Stack_Size);
+
+  while ((addr < &_estack) && (*addr == RTOS_STACK_PATTERN)) {
+    addr++;
+  }
+  return (uint32_t)&_estack - (uint32_t)addr;
+}
+
+/* prints the stack high-water mark of each task and the main stack, returns the max. stack usage in percent */
+uint32_t rtos_check_stack_usage(void)
+{
+  uint32_t max_usage = 0;
+
+  for (uint32_t i = 0; i < sizeof(rtos_task_stack_size) / sizeof(rtos_task_stack_size[0]); i++) {
+    TaskHandle_t task = *rtos_task_stack_size[i].handle;
+    if (!task) {
+      continue;
+    }
+    uint32_t size  = rtos_task_stack_size[i].size;
+    uint32_t used  = size - uxTaskGetStackHighWaterMark(task);
+    uint32_t usage = used * 100 / size;
+    if (usage >= STACK_USAGE_WARNING_THRESHOLD) {
+      LOG_WARNING("stack usage of %s is high (%lu of %lu words)", pcTaskGetName(task), used, size);
+    } else {
+      LOG_VERBOSE("stack usage of %s: %lu of %lu words", pcTaskGetName(task), used, size);
+    }
+    if (usage > max_usage) {
+      max_usage = usage;
+    }
+  }
+
+  uint32_t size  = (uint32_t)&_Min_Stack_Size;
+  uint32_t used  = rtos_get_main_stack_usage();
+  uint32_t usage = used * 100 / size;
+  if (usage >= STACK_USAGE_WARNING_THRESHOLD) {
+    LOG_WARNING("main stack usage is high (%lu of %lu bytes)", used, size);
+  } else {
+    LOG_VERBOSE("main stack usage: %lu of %lu bytes", used, size);
+  }
+  if (usage > max_usage) {
+    max_usage = usage;
+  }
+  return max_usage;
+}
+
+/* called at the beginning of each ISR (ISR_ON_IND), only the outermost ISR is timed */
+void rtos_isr_enter(void)
+{
+#if LOG_TASK_STATS
+  if (isr_nesting++ == 0) {
+    isr_start = CYCLE_COUNTER_VALUE();
+  }
+#endif /* LOG_TASK_STATS */
+  TRACE_ISR_BEGIN();
+}
+
+/* called at the end of each ISR (ISR_OFF_IND) */
+void rtos_isr_exit(void)
+{
+  TRACE_ISR_END();
+#if LOG_TASK_STATS
+  if (isr_nesting && (--isr_nesting == 0)) {
+    isr_cycles += CYCLE_COUNTER_VALUE() - isr_start;
+  }
+#endif /* LOG_TASK_STATS */
+}
+
+#if LOG_TASK_STATS
+
+/* prints the share of the CPU time of each task and of the ISRs since the last call
+ * note: the run-time counter is the lptimer, ISR time is also included in the time of the interrupted task */
+void rtos_log_task_stats(void)
+{
+  static uint32_t prev_runtime[RTOS_MAX_TASK_CNT + 1];    /* indexed by task number */
+  static uint32_t prev_total_runtime = 0;
+  static uint64_t prev_isr_cycles    = 0;
+  TaskStatus_t    task_status[RTOS_MAX_TASK_CNT];
+  uint32_t        total_runtime;
+
+  UBaseType_t task_cnt = uxTaskGetSystemState(task_status, RTOS_MAX_TASK_CNT, &total_runtime);
+  uint32_t    elapsed  = total_runtime - prev_total_runtime;
+  if (!task_cnt || !elapsed) {
+    return;
+  }
+  for (uint32_t i = 0; i < task_cnt; i++) {
+    uint32_t idx = task_status[i].xTaskNumber;
+    if (idx > RTOS_MAX_TASK_CNT) {
+      continue;
+    }
+    uint32_t runtime = task_status[i].ulRunTimeCounter - prev_runtime[idx];
+    uint32_t share   = (uint64_t)runtime * 10000 / elapsed;
+    prev_runtime[idx] = task_status[i].ulRunTimeCounter;
+    LOG_INFO("CPU time %-16s %3lu.%02lu%%", task_status[i].pcTaskName, share / 100, share % 100);
+  }
+  uint64_t isr_us     = (isr_cycles - prev_isr_cycles) / (SystemCoreClock / 1000000);
+  uint64_t elapsed_us = (uint64_t)elapsed * 1000000 / LPTIMER_SECOND;
+  uint32_t isr_share  = isr_us * 10000 / elapsed_us;
+  LOG_INFO("CPU time %-16s %3lu.%02lu%%", "ISRs", isr_share / 100, isr_share % 100);
+
+  prev_isr_cycles    = isr_cycles;
+  prev_total_runtime = total_runtime;
+}
+
+#endif /* LOG_TASK_STATS */
+
 /* USER CODE END Application */
 
 /************************ (C) COPYRIGHT STMicroelectronics *****END OF FILE****/
@@ -0,0 +1,133 @@
+/*
+ * Copyright (c) 2022, ETH Zurich, Computer Engineering Group (TEC)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * monotonic 64-bit local clock
+ *
+ * Extends the 16-bit LPTIM1 counter with the number of counter overflows. The
+ * overflow count is derived from a sequence number which the LPTIM1 ISR
+ * increments twice per overflow (odd while the overflow is being handled).
+ * Readers retry if the sequence number changed during the read. A reader that
+ * interrupts the ISR sees an odd sequence number, which already accounts for
+ * the overflow, and a pending (not yet handled) overflow is detected with the
+ * ARRM flag. This makes local_clock_now() safe to call from any context
+ * without disabling interrupts.
+ * Note: the ARRM flag is set when the counter matches ARR (0xffff), i.e. one
+ * tick before the counter wraps. A pending overflow is therefore only counted
+ * once the counter is in the lower half of its range. The ISR does not wait
+ * for the wrap: if it handles the overflow while the counter still reads
+ * 0xffff, it sets wrap_pending and readers that see 0xffff without the ARRM
+ * flag don't count that overflow yet. This relies on the ARRM flag of the
+ * next overflow being visible once the counter reads 0xffff again (the flag
+ * is read after the counter).
+ *
+ * This is the only clock the application uses for timestamps, intervals and
+ * wakeups. It starts at the raw counter value (0 at boot) and is not aligned
+ * with lptimer_now(). Use local_clock_set_alarm() instead of lptimer_set().
+ */
+
+#include "main.h"
+
+
+/* Private define ------------------------------------------------------------*/
+
+#define LPTIM_PERIOD          0x10000UL         /* counter is started with ARR = 0xffff */
+
+
+/* Private variables ---------------------------------------------------------*/
+
+static volatile uint32_t overflow_seq = 0;      /* 2x the number of handled overflows, odd while an overflow is being handled */
+static volatile bool     wrap_pending = false;  /* the last overflow was handled before the counter wrapped */
+
+
+/* Functions -----------------------------------------------------------------*/
+
+/* the counter runs asynchronously to the APB clock, read it until two consecutive values match */
+static uint32_t read_counter(void)
+{
+  uint32_t cnt;
+  do {
+    cnt = LPTIM1->CNT;
+  } while (cnt != LPTIM1->CNT);
+  return cnt;
+}
+
+
+uint64_t local_clock_now(void)
+{
+  uint32_t seq, cnt, ovf;
+  bool     arrm, pending;
+  do {
+    seq     = overflow_seq;
+    pending = wrap_pending;
+    cnt     = read_counter();
+    arrm    = (LPTIM1->ISR & LPTIM_ISR_ARRM) != 0;
+    ovf     = (seq + 1) / 2;
+    if (seq & 1) {
+      if (cnt >= LPTIM_PERIOD / 2) {
+        ovf--;    /* overflow is being handled but the counter has not wrapped yet */
+      }
+    } else if (arrm) {
+      if (cnt < LPTIM_PERIOD / 2) {
+        ovf++;    /* counter has wrapped but the overflow has not been handled yet */
+      }
+    } else if (pending && (cnt == LPTIM_PERIOD - 1)) {
+      ovf--;      /* overflow has been handled but the counter has not wrapped yet */
+    }
+  } while (seq != overflow_seq);
+  return ((uint64_t)ovf * LPTIM_PERIOD) + cnt;
+}
+
+
+void local_clock_set_alarm(uint64_t timestamp, void (*callback)(void))
+{
+  uint64_t local, lp;
+
+  /* translate the timestamp into the lptimer time base */
+  do {
+    local = local_clock_now();
+    lp    = lptimer_now();
+  } while (local != local_clock_now());
+  lptimer_set(timestamp + (lp - local), callback);
+}
+
+
+bool local_clock_handle_overflow(void)
+{
+  if (!(LPTIM1->IER & LPTIM_IER_ARRMIE) || !(LPTIM1->ISR & LPTIM_ISR_ARRM)) {
+    return false;
+  }
+  overflow_seq++;
+  wrap_pending = (read_counter() == (LPTIM_PERIOD - 1));    /* ARRM is set one tick before the counter wraps */
+  LPTIM1->ICR  = LPTIM_ICR_ARRMCF;
+  (void)LPTIM1->ISR;                                        /* read back: the flag is cleared (APB domain) before the update is published */
+  overflow_seq++;
+  return true;
+}
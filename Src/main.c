@@ -20,7 +20,6 @@
 
 /* Includes ------------------------------------------------------------------*/
 #include "main.h"
-#include "cmsis_os.h"
 
 /* Private includes ----------------------------------------------------------*/
 /* USER CODE BEGIN Includes */
@@ -51,6 +50,8 @@ RTC_HandleTypeDef hrtc;
 
 SPI_HandleTypeDef hspi1;
 SPI_HandleTypeDef hspi2;
+DMA_HandleTypeDef hdma_spi1_rx;
+DMA_HandleTypeDef hdma_spi1_tx;
 
 TIM_HandleTypeDef htim2;
 TIM_HandleTypeDef htim16;
@@ -59,7 +60,6 @@ UART_HandleTypeDef huart1;
 DMA_HandleTypeDef hdma_usart1_rx;
 DMA_HandleTypeDef hdma_usart1_tx;
 
-osThreadId defaultTaskHandle;
 /* USER CODE BEGIN PV */
 
 nv_config_t     config;
@@ -78,7 +78,6 @@ static void MX_TIM16_Init(void);
 static void MX_LPTIM1_Init(void);
 static void MX_IWDG_Init(void);
 static void MX_RTC_Init(void);
-void StartDefaultTask(void const * argument);
 
 /* USER CODE BEGIN PFP */
 
@@ -97,7 +96,13 @@ int main(void)
 {
   /* USER CODE BEGIN 1 */
 
+  /* fill the main stack with a pattern to be able to determine its high-water mark */
+  rtos_paint_main_stack();
+
+  BOOT_TRACE_START();
+
   system_boot();
+  BOOT_TRACE("system_boot");
 
   /* USER CODE END 1 */
 
@@ -107,27 +112,55 @@ int main(void)
   HAL_Init();
 
   /* USER CODE BEGIN Init */
-
+  BOOT_TRACE("HAL_Init");
   /* USER CODE END Init */
 
   /* Configure the system clock */
   SystemClock_Config();
 
   /* USER CODE BEGIN SysInit */
+  BOOT_TRACE("SystemClock_Config");
 
-  /* USER CODE END SysInit */
-
-  /* Initialize all configured peripherals */
+  /* note: the MX_*_Init() calls are not generated by CubeMX, they are called here to be able to trace each init stage */
   MX_GPIO_Init();
+  BOOT_TRACE("MX_GPIO_Init");
   MX_DMA_Init();
+  BOOT_TRACE("MX_DMA_Init");
+#if RADIO_PERIPH_INIT
   MX_SPI2_Init();
+  BOOT_TRACE("MX_SPI2_Init");
+#else
+  hspi2.Instance = SPI2;        /* radio not used */
+  __HAL_RCC_SPI2_CLK_DISABLE();
+  __HAL_RCC_SPI2_CLK_SLEEP_DISABLE();
+#endif /* RADIO_PERIPH_INIT */
   MX_SPI1_Init();
+  BOOT_TRACE("MX_SPI1_Init");
+#if LOG_ENABLE || CLI_ENABLE
   MX_USART1_UART_Init();
+  BOOT_TRACE("MX_USART1_UART_Init");
+#else
+  huart1.Instance = USART1;     /* UART not needed */
+#endif /* LOG_ENABLE || CLI_ENABLE */
   MX_TIM2_Init();
+  BOOT_TRACE("MX_TIM2_Init");
+#if RADIO_PERIPH_INIT
   MX_TIM16_Init();
+  BOOT_TRACE("MX_TIM16_Init");
+#else
+  htim16.Instance = TIM16;      /* radio not used */
+  __HAL_RCC_TIM16_CLK_DISABLE();
+  __HAL_RCC_TIM16_CLK_SLEEP_DISABLE();
+#endif /* RADIO_PERIPH_INIT */
   MX_LPTIM1_Init();
+  BOOT_TRACE("MX_LPTIM1_Init");
   MX_IWDG_Init();
+  BOOT_TRACE("MX_IWDG_Init");
   MX_RTC_Init();
+  BOOT_TRACE("MX_RTC_Init");
+
+  /* USER CODE END SysInit */
+
   /* USER CODE BEGIN 2 */
 
   /* print firmware and compiler info as well as the node ID */
@@ -135,9 +168,20 @@ int main(void)
   LOG_INFO("reset flag: %s", system_get_reset_cause(0));
 
   system_init();
+  BOOT_TRACE("system_init");
+
+  /* DWT cycle counter for execution time measurements */
+  CYCLE_COUNTER_ENABLE();
+
+  /* select and verify the CRC16 implementation for DPP messages */
+  crc16_init();
+  BOOT_TRACE("crc16_init");
 
   /* initialize state machine for handling low-power modes */
   lpm_init(0, 0);
+  BOOT_TRACE("lpm_init");
+
+  BOOT_TRACE_PRINT();
 
   /* USER CODE END 2 */
 
@@ -157,20 +201,15 @@ int main(void)
   /* add queues, ... */
   /* USER CODE END RTOS_QUEUES */
 
-  /* Create the thread(s) */
-  /* definition and creation of defaultTask */
-  osThreadDef(defaultTask, StartDefaultTask, osPriorityNormal, 0, 256);
-  defaultTaskHandle = osThreadCreate(osThread(defaultTask), NULL);
-
   /* USER CODE BEGIN RTOS_THREADS */
   /* FreeRTOS tasks, queues, etc. */
   rtos_init();
 
+  /* start the scheduler directly, the CMSIS-OS layer is not part of the build (note: CubeMX re-adds the cmsis_os.h include and the osKernelStart() call below when the code is regenerated, remove them again) */
+  vTaskStartScheduler();
+
   /* USER CODE END RTOS_THREADS */
 
-  /* Start scheduler */
-  osKernelStart();
- 
   /* We should never get here as control is now taken by the scheduler */
   /* Infinite loop */
   /* USER CODE BEGIN WHILE */
@@ -529,6 +568,10 @@ static void MX_TIM2_Init(void)
   {
     Error_Handler();
   }
+  if (HAL_TIM_IC_ConfigChannel(&htim2, &sConfigIC, TIM_CHANNEL_4) != HAL_OK)
+  {
+    Error_Handler();
+  }
   sConfigOC.OCMode = TIM_OCMODE_TIMING;
   sConfigOC.Pulse = 0xFFFFFFFF;
   sConfigOC.OCPolarity = TIM_OCPOLARITY_HIGH;
@@ -654,6 +697,12 @@ static void MX_DMA_Init(void)
   __HAL_RCC_DMA1_CLK_ENABLE();
 
   /* DMA interrupt init */
+  /* DMA1_Channel2_IRQn interrupt configuration */
+  HAL_NVIC_SetPriority(DMA1_Channel2_IRQn, 5, 0);
+  HAL_NVIC_EnableIRQ(DMA1_Channel2_IRQn);
+  /* DMA1_Channel3_IRQn interrupt configuration */
+  HAL_NVIC_SetPriority(DMA1_Channel3_IRQn, 5, 0);
+  HAL_NVIC_EnableIRQ(DMA1_Channel3_IRQn);
   /* DMA1_Channel4_IRQn interrupt configuration */
   HAL_NVIC_SetPriority(DMA1_Channel4_IRQn, 5, 0);
   HAL_NVIC_EnableIRQ(DMA1_Channel4_IRQn);
@@ -708,12 +757,6 @@ static void MX_GPIO_Init(void)
   GPIO_InitStruct.Pull = GPIO_NOPULL;
   HAL_GPIO_Init(GPIOA, &GPIO_InitStruct);
 
-  /*Configure GPIO pin : COM_TREQ_Pin */
-  GPIO_InitStruct.Pin = COM_TREQ_Pin;
-  GPIO_InitStruct.Mode = GPIO_MODE_IT_RISING;
-  GPIO_InitStruct.Pull = GPIO_PULLDOWN;
-  HAL_GPIO_Init(COM_TREQ_GPIO_Port, &GPIO_InitStruct);
-
   /*Configure GPIO pin : BOLT_ACK_Pin */
   GPIO_InitStruct.Pin = BOLT_ACK_Pin;
   GPIO_InitStruct.Mode = GPIO_MODE_INPUT;
@@ -757,9 +800,6 @@ static void MX_GPIO_Init(void)
   HAL_GPIO_Init(LED_RED_GPIO_Port, &GPIO_InitStruct);
 
   /* EXTI interrupt init*/
-  HAL_NVIC_SetPriority(EXTI3_IRQn, 5, 0);
-  HAL_NVIC_EnableIRQ(EXTI3_IRQn);
-
   HAL_NVIC_SetPriority(EXTI15_10_IRQn, 5, 0);
   HAL_NVIC_EnableIRQ(EXTI15_10_IRQn);
 
@@ -769,25 +809,6 @@ static void MX_GPIO_Init(void)
 
 /* USER CODE END 4 */
 
-/* USER CODE BEGIN Header_StartDefaultTask */
-/**
-  * @brief  Function implementing the defaultTask thread.
-  * @param  argument: Not used
-  * @retval None
-  */
-/* USER CODE END Header_StartDefaultTask */
-void StartDefaultTask(void const * argument)
-{
-  /* USER CODE BEGIN 5 */
-  vTaskSuspend(NULL);       // we don't need this task
-  /* Infinite loop */
-  for(;;)
-  {
-    osDelay(1);
-  }
-  /* USER CODE END 5 */ 
-}
-
  /**
   * @brief  Period elapsed callback in non blocking mode
   * @note   This function is called  when TIM1 interrupt took place, inside
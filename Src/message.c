@@ -35,118 +35,274 @@
 #include "main.h"
 
 
+/* Global variables ----------------------------------------------------------*/
+
+extern TaskHandle_t xTaskHandle_helloworld;
+
+
+/* Private define ------------------------------------------------------------*/
+
+#define CMD_HANDLER_CNT         ((uint32_t)(__cmd_handlers_end - __cmd_handlers_start))
+#define CMD_HANDLER_IDX_NONE    0xff
+
+/* priority classes of the outbound message queue, lower value = higher priority */
+#define MSG_PRIO_HIGH           0       /* health and event messages */
+#define MSG_PRIO_LOW            1       /* everything else */
+#define MSG_PRIO_CNT            2
+
+/* the header fields up to (excluding) the sequence number are constant for a given message type */
+#define MSG_HDR_CONST_LEN       offsetof(dpp_header_t, seqnr)
+#define MSG_TEMPLATE_CNT        (sizeof(msg_templates) / sizeof(msg_template_t))
+
+
+/* Private typedefs ----------------------------------------------------------*/
+
+typedef struct {
+  dpp_message_type_t type;
+  uint8_t            payload_len;
+  uint8_t            prio;
+} msg_template_t;
+
+typedef struct {
+  uint32_t queue_hwm;     /* max. number of messages in the outbound queue */
+  uint32_t dropped;       /* number of messages dropped (no free buffer or invalid type) */
+  uint32_t written;       /* number of messages written to BOLT */
+  uint32_t latency_max;   /* max. enqueue-to-write latency in lptimer ticks */
+  uint64_t latency_sum;   /* sum of all enqueue-to-write latencies in lptimer ticks */
+} msg_queue_stats_t;
+
+
 /* Private variables ---------------------------------------------------------*/
 
-static dpp_message_t msg_buffer;
+static dpp_message_t msg_pool[MSG_POOL_SIZE];                       /* preallocated buffers for outgoing messages */
+static uint32_t      msg_pool_free     = (uint32_t)((1ULL << MSG_POOL_SIZE) - 1);   /* bitmask of free buffers */
+static uint32_t      msg_pool_free_min = MSG_POOL_SIZE;                            /* low-water mark of the number of free buffers */
+static uint16_t      msg_seq_no        = 0;                                        /* sequence number of the next message */
+
+/* outbound queue: one FIFO per priority class, each queued message occupies a pool buffer -> the FIFOs can't overflow */
+static dpp_message_t*    msg_queue[MSG_PRIO_CNT][MSG_POOL_SIZE];
+static uint32_t          msg_queue_rd[MSG_PRIO_CNT];
+static uint32_t          msg_queue_cnt[MSG_PRIO_CNT];
+static uint64_t          msg_enqueue_time[MSG_POOL_SIZE];     /* enqueue timestamp in lptimer ticks, indexed by pool buffer */
+static msg_queue_stats_t msg_queue_stats;
+
+/* per message type header template */
+static const msg_template_t msg_templates[] = {
+  { DPP_MSG_TYPE_COM_HEALTH, sizeof(dpp_com_health_t), MSG_PRIO_HIGH },
+  { DPP_MSG_TYPE_EVENT,      sizeof(dpp_event_t),      MSG_PRIO_HIGH },
+  { DPP_MSG_TYPE_CMD,        DPP_CMD_MIN_LEN,          MSG_PRIO_LOW  },
+  { DPP_MSG_TYPE_NODE_INFO,  sizeof(dpp_node_info_t),  MSG_PRIO_LOW  },
+  { DPP_MSG_TYPE_TIMESYNC,   sizeof(dpp_timestamp_t),  MSG_PRIO_LOW  },
+};
+#if MSG_HDR_CRC_RESUME
+static uint16_t msg_template_crc[MSG_TEMPLATE_CNT];   /* CRC over the constant header part, calculated on first use */
+static bool     msg_template_crc_valid = false;
+#endif /* MSG_HDR_CRC_RESUME */
+
+_Static_assert(offsetof(dpp_header_t, device_id)   < MSG_HDR_CONST_LEN &&
+               offsetof(dpp_header_t, type)        < MSG_HDR_CONST_LEN &&
+               offsetof(dpp_header_t, payload_len) < MSG_HDR_CONST_LEN &&
+               offsetof(dpp_header_t, target_id)   < MSG_HDR_CONST_LEN, "unexpected DPP header layout");
+
+
+/* command handler table, populated at link time by COMMAND_HANDLER() */
+extern const cmd_handler_t __cmd_handlers_start[];
+extern const cmd_handler_t __cmd_handlers_end[];
+
+static uint8_t      cmd_handler_idx[256];                     /* maps the low byte of the command type to an index into the handler table */
+static bool         cmd_handler_idx_valid = false;
+static cmd_stats_t  cmd_stats[COMMAND_HANDLER_MAX_CNT];       /* invocation statistics, same order as the handler table */
+
+
+/* Command handlers ----------------------------------------------------------*/
+
+static bool cmd_reset(const dpp_command_t* cmd, const dpp_header_t* hdr)
+{
+  LOG_WARNING("resetting...");
+  NVIC_SystemReset();
+  return true;
+}
+COMMAND_HANDLER(DPP_COMMAND_RESET, cmd_reset);
+COMMAND_HANDLER(CMD_SX1262_RESET, cmd_reset);
+
 
 #if BASEBOARD
-LIST_CREATE(pending_commands, sizeof(scheduled_cmd_t), COMMAND_QUEUE_SIZE);
+
+static bool cmd_baseboard_enable_disable(const dpp_command_t* cmd, const dpp_header_t* hdr)
+{
+  uint32_t sched_time = cmd->arg32[0];
+  uint16_t arg        = 0;
+
+  if (cmd->arg[4] & 1) {
+    /* relative time -> append generation time */
+    if (hdr) {
+      sched_time += hdr->generation_time / 1000000;
+    }
+  }
+  if (cmd->type == CMD_SX1262_BASEBOARD_ENABLE) {
+    arg = (uint16_t)cmd->arg[6] << 8 | cmd->arg[5];
+  }
+  uint16_t id = cmd_queue_add(cmd->type, arg, sched_time);
+  if (id == CMD_QUEUE_ID_INVALID) {
+    LOG_WARNING("failed to add command to queue");
+  } else {
+    LOG_VERBOSE("baseboard command %u scheduled (time: %lu  id: %u)", cmd->type & 0xff, sched_time, id);
+    /* let the hello world task rearm its wakeup timer */
+    xTaskNotifyGive(xTaskHandle_helloworld);
+  }
+  return true;
+}
+COMMAND_HANDLER(CMD_SX1262_BASEBOARD_ENABLE, cmd_baseboard_enable_disable);
+COMMAND_HANDLER(CMD_SX1262_BASEBOARD_DISABLE, cmd_baseboard_enable_disable);
+
+
+static bool cmd_baseboard_enable_periodic(const dpp_command_t* cmd, const dpp_header_t* hdr)
+{
+  config.bb_en.period = (uint32_t)cmd->arg16[1] * 60;  /* convert to seconds */
+  if (config.bb_en.period > 0) {
+    config.bb_en.starttime = rtc_get_next_timestamp_at_daytime(0, cmd->arg[0], cmd->arg[1], 0);
+    if (config.bb_en.starttime > 0) {
+      LOG_INFO("periodic baseboard enable scheduled (next: %u  period: %us)", config.bb_en.starttime, config.bb_en.period);
+    } else {
+      LOG_WARNING("invalid parameters for periodic enable cmd");
+    }
+  } else {
+    config.bb_en.starttime = 0;
+    LOG_INFO("periodic baseboard enable cleared");
+  }
+  xTaskNotifyGive(xTaskHandle_helloworld);
+  if (!nvcfg_save(&config)) {
+    LOG_ERROR("failed to save config");
+  }
+  return true;
+}
+COMMAND_HANDLER(CMD_SX1262_BASEBOARD_ENABLE_PERIODIC, cmd_baseboard_enable_periodic);
+
+
+static bool cmd_baseboard_power_ext3(const dpp_command_t* cmd, const dpp_header_t* hdr)
+{
+  if (cmd->arg[0]) {
+    PIN_SET(BASEBOARD_EXT3_SWITCH);
+    LOG_INFO("EXT3 power enabled");
+  } else {
+    PIN_CLR(BASEBOARD_EXT3_SWITCH);
+    LOG_INFO("EXT3 power disabled");
+  }
+  return true;
+}
+COMMAND_HANDLER(CMD_SX1262_BASEBOARD_POWER_EXT3, cmd_baseboard_power_ext3);
+
 #endif /* BASEBOARD */
 
 
 /* Functions -----------------------------------------------------------------*/
 
-bool process_command(const dpp_command_t* cmd, const dpp_header_t* hdr)
+static void build_command_index(void)
 {
-  bool cfg_changed = false;
-#if BASEBOARD
-  scheduled_cmd_t sched_cmd;
-#endif /* BASEBOARD */
+  uint32_t i;
 
-  if (!cmd) {
-    return false;
+  for (i = 0; i < sizeof(cmd_handler_idx); i++) {
+    cmd_handler_idx[i] = CMD_HANDLER_IDX_NONE;
   }
+  if (CMD_HANDLER_CNT > COMMAND_HANDLER_MAX_CNT) {
+    LOG_ERROR("too many command handlers (%lu), increase COMMAND_HANDLER_MAX_CNT", CMD_HANDLER_CNT);
+  }
+  for (i = 0; (i < CMD_HANDLER_CNT) && (i < COMMAND_HANDLER_MAX_CNT); i++) {
+    uint8_t key = __cmd_handlers_start[i].type & 0xff;
+    if (cmd_handler_idx[key] == CMD_HANDLER_IDX_NONE) {
+      cmd_handler_idx[key] = i;
+    }
+  }
+  cmd_handler_idx_valid = true;
+}
 
-  switch (cmd->type) {
-
-    case DPP_COMMAND_RESET:
-    case CMD_SX1262_RESET:
-      LOG_WARNING("resetting...");
-      NVIC_SystemReset();
-      break;
 
-#if BASEBOARD
+/* returns the index of the handler for the given command type or CMD_HANDLER_IDX_NONE */
+static uint32_t find_command_handler(dpp_command_type_t type)
+{
+  uint32_t idx = cmd_handler_idx[type & 0xff];
 
-    case CMD_SX1262_BASEBOARD_ENABLE:
-    case CMD_SX1262_BASEBOARD_DISABLE:
-      sched_cmd.type           = cmd->type;
-      sched_cmd.scheduled_time = cmd->arg32[0];
-      sched_cmd.arg            = 0;
-      if (cmd->arg[4] & 1) {
-        /* relative time -> append generation time */
-        if (hdr) {
-          sched_cmd.scheduled_time += hdr->generation_time / 1000000;
-        }
+  if ((idx != CMD_HANDLER_IDX_NONE) && (__cmd_handlers_start[idx].type != type)) {
+    /* several command types share the same low byte -> search the table */
+    for (idx = 0; (idx < CMD_HANDLER_CNT) && (idx < COMMAND_HANDLER_MAX_CNT); idx++) {
+      if (__cmd_handlers_start[idx].type == type) {
+        return idx;
       }
-      if (cmd->type == CMD_SX1262_BASEBOARD_ENABLE) {
-        sched_cmd.arg = (uint16_t)cmd->arg[6] << 8 | cmd->arg[5];
-      }
-      if (!list_insert(pending_commands, sched_cmd.scheduled_time, &sched_cmd)) {
-        LOG_WARNING("failed to add command to queue");
-      } else {
-        LOG_VERBOSE("baseboard command %u scheduled (time: %lu)", cmd->type & 0xff, sched_cmd.scheduled_time);
-      }
-      break;
+    }
+    idx = CMD_HANDLER_IDX_NONE;
+  }
+  return idx;
+}
 
-    case CMD_SX1262_BASEBOARD_ENABLE_PERIODIC:
-      config.bb_en.period = (uint32_t)cmd->arg16[1] * 60;  /* convert to seconds */
-      if (config.bb_en.period > 0) {
-        config.bb_en.starttime = rtc_get_next_timestamp_at_daytime(0, cmd->arg[0], cmd->arg[1], 0);
-        if (config.bb_en.starttime > 0) {
-          LOG_INFO("periodic baseboard enable scheduled (next: %u  period: %us)", config.bb_en.starttime, config.bb_en.period);
-        } else {
-          LOG_WARNING("invalid parameters for periodic enable cmd");
-        }
-      } else {
-        config.bb_en.starttime = 0;
-        LOG_INFO("periodic baseboard enable cleared");
-      }
-      cfg_changed = true;
-      break;
 
-    case CMD_SX1262_BASEBOARD_POWER_EXT3:
-      if (cmd->arg[0]) {
-        PIN_SET(BASEBOARD_EXT3_SWITCH);
-        LOG_INFO("EXT3 power enabled");
-      } else {
-        PIN_CLR(BASEBOARD_EXT3_SWITCH);
-        LOG_INFO("EXT3 power disabled");
-      }
-      break;
+bool process_command(const dpp_command_t* cmd, const dpp_header_t* hdr)
+{
+  if (!cmd) {
+    return false;
+  }
+  if (!cmd_handler_idx_valid) {
+    build_command_index();
+  }
 
-#endif /* BASEBOARD */
+  uint32_t idx = find_command_handler(cmd->type);
+  if (idx == CMD_HANDLER_IDX_NONE) {
+    /* unknown command -> command processing failed */
+    return false;
+  }
 
-    default:
-      /* unknown command -> command processing failed */
-      return false;
-      break;
+  uint32_t t_start = CYCLE_COUNTER_VALUE();
+  bool     success = __cmd_handlers_start[idx].handler(cmd, hdr);
+  uint32_t cycles  = CYCLE_COUNTER_VALUE() - t_start;
+
+  cmd_stats[idx].count++;
+  cmd_stats[idx].cycles += cycles;
+  if (cycles > cmd_stats[idx].max_cycles) {
+    cmd_stats[idx].max_cycles = cycles;
   }
 
-  if (cfg_changed) {
-    if (!nvcfg_save(&config)) {
-      LOG_ERROR("failed to save config");
+  return success;
+}
+
+
+/* prints the invocation count and execution time of all commands that have been executed */
+void log_command_stats(void)
+{
+  for (uint32_t i = 0; (i < CMD_HANDLER_CNT) && (i < COMMAND_HANDLER_MAX_CNT); i++) {
+    if (cmd_stats[i].count) {
+      LOG_INFO("cmd %u: %lu calls, avg %lu cycles, max %lu cycles", __cmd_handlers_start[i].type & 0xff, cmd_stats[i].count, (uint32_t)(cmd_stats[i].cycles / cmd_stats[i].count), cmd_stats[i].max_cycles);
     }
   }
-
-  return true;
 }
 
 
-/* returns true if message is valid */
-bool process_message(dpp_message_t* msg, bool rcvd_from_bolt)
+/* returns true if the message has a valid type, length and CRC; rcvd_len is the number of received bytes (0 = unknown) */
+bool validate_message(const dpp_message_t* msg, uint32_t rcvd_len)
 {
+  if (!msg) {
+    return false;
+  }
   uint16_t msg_len = DPP_MSG_LEN(msg);
 
-  /* check message type, length and CRC */
-  if (!msg ||
-      msg->header.type & DPP_MSG_TYPE_MIN ||
-      msg_len > DPP_MSG_PKT_LEN           ||
-      msg->header.payload_len == 0        ||
-      DPP_MSG_GET_CRC16(msg) != crc16((uint8_t*)msg, msg_len - 2, 0)) {
-    LOG_ERROR("msg with invalid length or CRC (src: %u  len: %ub  type: %u)", msg->header.device_id, msg_len, msg->header.type);
+  /* the received length is only known if the message has just been read from BOLT */
+  if (msg->header.type & DPP_MSG_TYPE_MIN    ||
+      msg_len > DPP_MSG_PKT_LEN              ||
+      msg->header.payload_len == 0           ||
+      (rcvd_len && (msg_len > rcvd_len))) {
+    LOG_ERROR("msg with invalid length (src: %u  len: %ub  type: %u)", msg->header.device_id, msg_len, msg->header.type);
+    return false;
+  }
+  if (DPP_MSG_GET_CRC16(msg) != crc16_fast((const uint8_t*)msg, msg_len - 2, 0)) {
+    LOG_ERROR("msg with invalid CRC (src: %u  len: %ub  type: %u)", msg->header.device_id, msg_len, msg->header.type);
     return false;
   }
-  LOG_VERBOSE("msg type: %u  src: %u  len: %uB   target: %u", msg->header.type, msg->header.device_id, msg_len, msg->header.target_id);
+  return true;
+}
+
+
+/* processes a message that has already passed validate_message(), returns true if the message was processed */
+bool process_validated_message(dpp_message_t* msg, bool rcvd_from_bolt)
+{
+  LOG_VERBOSE("msg type: %u  src: %u  len: %uB   target: %u", msg->header.type, msg->header.device_id, DPP_MSG_LEN(msg), msg->header.target_id);
 
   /* only process the message if target ID matched the node ID */
   if ((msg->header.target_id == NODE_ID) || (msg->header.target_id == DPP_DEVICE_ID_BROADCAST)) {
@@ -183,19 +339,21 @@ bool process_message(dpp_message_t* msg, bool rcvd_from_bolt)
 void process_scheduled_commands(void)
 {
   uint32_t               curr_time = get_time(0) / 1000000;
-  const scheduled_cmd_t* next_cmd  = list_get_head(pending_commands);
+  const scheduled_cmd_t* next_cmd  = cmd_queue_peek();
+  scheduled_cmd_t        cmd;
 
   /* there are pending commands */
   /* anything that needs to be executed now? */
   while (next_cmd && (next_cmd->scheduled_time <= curr_time)) {
+    cmd_queue_pop(&cmd);
 
-    switch (next_cmd->type) {
+    switch (cmd.type) {
 
       case CMD_SX1262_BASEBOARD_ENABLE:
         BASEBOARD_ENABLE();
         BASEBOARD_WAKE();
         LOG_INFO("baseboard enabled");
-        generate_command(CMD_BASEBOARD_WAKEUP_MODE, next_cmd->arg);
+        generate_command(CMD_BASEBOARD_WAKEUP_MODE, cmd.arg);
         break;
 
       case CMD_SX1262_BASEBOARD_DISABLE:
@@ -207,8 +365,7 @@ void process_scheduled_commands(void)
         LOG_WARNING("unknown command");
         break;
     }
-    list_remove_head(pending_commands, 0);
-    next_cmd = list_get_head(pending_commands);
+    next_cmd = cmd_queue_peek();
   }
 
   if (next_cmd) {
@@ -219,74 +376,197 @@ void process_scheduled_commands(void)
   if ((config.bb_en.starttime > 0) && (config.bb_en.starttime <= curr_time)) {
     BASEBOARD_ENABLE();
     BASEBOARD_WAKE();
-    while ((config.bb_en.period > 0) && (config.bb_en.starttime < curr_time)) {
-      config.bb_en.starttime += config.bb_en.period;
+    if (config.bb_en.period > 0) {
+      /* advance to the next enable time in the future, otherwise get_next_command_time() keeps returning the current time */
+      while (config.bb_en.starttime <= curr_time) {
+        config.bb_en.starttime += config.bb_en.period;
+      }
+      LOG_INFO("baseboard enabled (next wakeup in %us)", config.bb_en.period);
+    } else {
+      config.bb_en.starttime = 0;     /* one-shot enable */
+      LOG_INFO("baseboard enabled");
     }
-    LOG_INFO("baseboard enabled (next wakeup in %us)", config.bb_en.period);
   }
 }
 
 #endif /* BASEBOARD */
 
 
+/* returns a free message buffer from the pool or NULL if all buffers are in use (ISR safe), the sequence number in the header is already set */
+dpp_message_t* msg_pool_acquire(void)
+{
+  dpp_message_t* msg     = 0;
+  uint32_t       primask = __get_PRIMASK();
+
+  __disable_irq();
+  if (msg_pool_free) {
+    uint32_t idx   = __CLZ(__RBIT(msg_pool_free));     /* index of the lowest set bit */
+    msg_pool_free &= ~(1UL << idx);
+    msg            = &msg_pool[idx];
+    msg->header.seqnr = msg_seq_no++;                  /* taken here to keep the increment atomic */
+    uint32_t free_cnt = __builtin_popcount(msg_pool_free);
+    if (free_cnt < msg_pool_free_min) {
+      msg_pool_free_min = free_cnt;
+    }
+  }
+  __set_PRIMASK(primask);
+
+  if (!msg) {
+    msg_queue_stats.dropped++;
+  }
+  return msg;
+}
+
+
+/* returns a message buffer to the pool (ISR safe) */
+void msg_pool_release(dpp_message_t* msg)
+{
+  if (!msg || (msg < msg_pool) || (msg >= &msg_pool[MSG_POOL_SIZE])) {
+    LOG_ERROR("invalid message buffer");
+    return;
+  }
+  uint32_t idx     = msg - msg_pool;
+  uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+  msg_pool_free |= (1UL << idx);
+  __set_PRIMASK(primask);
+}
+
+
+/* returns the min. number of free message buffers since boot */
+uint32_t msg_pool_get_free_min(void)
+{
+  return msg_pool_free_min;
+}
+
+
 /*
- * send message to BOLT
+ * queue a message for BOLT
+ * composes the header and CRC in place, the buffer must be obtained from msg_pool_acquire() and is released once the message has been written to BOLT
  */
-bool send_message(dpp_message_type_t type)
+bool send_message(dpp_message_t* msg, dpp_message_type_t type)
 {
-  /* separate sequence number for each interface */
-  static uint16_t seq_no = 0;
-  uint32_t        len    = 0;
-
-  /* compose the message header */
-  msg_buffer.header.device_id   = NODE_ID;
-  msg_buffer.header.type        = type;
-  msg_buffer.header.payload_len = len;
-  switch(type) {
-    case DPP_MSG_TYPE_COM_HEALTH:
-      msg_buffer.header.payload_len = sizeof(dpp_com_health_t);
-      break;
-    case DPP_MSG_TYPE_CMD:
-      msg_buffer.header.payload_len = DPP_CMD_MIN_LEN;
-      break;
-    case DPP_MSG_TYPE_EVENT:
-      msg_buffer.header.payload_len = sizeof(dpp_event_t);
-      break;
-    case DPP_MSG_TYPE_NODE_INFO:
-      msg_buffer.header.payload_len = sizeof(dpp_node_info_t);
-      break;
-    case DPP_MSG_TYPE_TIMESYNC:
-      msg_buffer.header.payload_len = sizeof(dpp_timestamp_t);
-      break;
-    default:
-      LOG_WARNING("unknown message type");
-      return false;
+  uint32_t idx;
+
+  TRACE_BEGIN(TRACE_ID_SEND_MSG);
+
+  for (idx = 0; idx < MSG_TEMPLATE_CNT; idx++) {
+    if (msg_templates[idx].type == type) {
       break;
+    }
+  }
+  if (idx == MSG_TEMPLATE_CNT) {
+    LOG_WARNING("unknown message type");
+    msg_pool_release(msg);
+    msg_queue_stats.dropped++;
+    TRACE_END(TRACE_ID_SEND_MSG);
+    return false;
   }
-  msg_buffer.header.target_id       = NODE_ID;
-  msg_buffer.header.seqnr           = seq_no++;
-  msg_buffer.header.generation_time = get_time(0);
+  uint32_t prio = msg_templates[idx].prio;
 
-  /* calculate and append the CRC */
-  uint32_t msg_buffer_len = DPP_MSG_LEN(&msg_buffer);
-  uint16_t crc            = crc16((uint8_t*)&msg_buffer, msg_buffer_len - 2, 0);
-  DPP_MSG_SET_CRC16(&msg_buffer, crc);
+  /* compose the message header: constant part from the template, then the variable fields */
+  msg->header.device_id       = NODE_ID;
+  msg->header.type            = type;
+  msg->header.payload_len     = msg_templates[idx].payload_len;
+  msg->header.target_id       = NODE_ID;
+  msg->header.generation_time = get_time(0);
 
-  if (!bolt_write((uint8_t*)&msg_buffer, msg_buffer_len)) {
-    LOG_WARNING("msg dropped (BOLT queue full)");
-    return false;
+  /* calculate and append the CRC */
+  uint32_t msg_len = DPP_MSG_LEN(msg);
+#if MSG_HDR_CRC_RESUME
+  if (!msg_template_crc_valid) {
+    for (uint32_t i = 0; i < MSG_TEMPLATE_CNT; i++) {
+      dpp_header_t hdr;
+      hdr.device_id   = NODE_ID;
+      hdr.type        = msg_templates[i].type;
+      hdr.payload_len = msg_templates[i].payload_len;
+      hdr.target_id   = NODE_ID;
+      msg_template_crc[i] = crc16_fast((uint8_t*)&hdr, MSG_HDR_CONST_LEN, 0);
+    }
+    msg_template_crc_valid = true;
+  }
+  /* resume from the precalculated CRC of the constant header part */
+  uint16_t crc = crc16_fast((uint8_t*)msg + MSG_HDR_CONST_LEN, msg_len - MSG_HDR_CONST_LEN - 2, msg_template_crc[idx]);
+#else
+  uint16_t crc = crc16_fast((uint8_t*)msg, msg_len - 2, 0);
+#endif /* MSG_HDR_CRC_RESUME */
+  DPP_MSG_SET_CRC16(msg, crc);
+
+  /* append to the queue of the corresponding priority class */
+  msg_enqueue_time[msg - msg_pool] = local_clock_now();
+  uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+  msg_queue[prio][(msg_queue_rd[prio] + msg_queue_cnt[prio]) % MSG_POOL_SIZE] = msg;
+  msg_queue_cnt[prio]++;
+  uint32_t queue_size = msg_queue_cnt[MSG_PRIO_HIGH] + msg_queue_cnt[MSG_PRIO_LOW];
+  if (queue_size > msg_queue_stats.queue_hwm) {
+    msg_queue_stats.queue_hwm = queue_size;
   }
-  LOG_VERBOSE("msg of type %u and length %u bytes written to BOLT", type, msg_buffer_len);
+  __set_PRIMASK(primask);
+  LOG_VERBOSE("msg of type %u and length %u bytes queued", type, msg_len);
+
+  TRACE_END(TRACE_ID_SEND_MSG);
   return true;
 }
 
 
+/*
+ * write queued messages to BOLT, highest priority class first
+ * returns the number of written messages; if BOLT is full, the remaining messages stay queued for the next call
+ */
+uint32_t send_queued_messages(void)
+{
+  uint32_t cnt = 0;
+
+  for (uint32_t prio = 0; prio < MSG_PRIO_CNT; prio++) {
+    while (msg_queue_cnt[prio]) {
+      dpp_message_t* msg = msg_queue[prio][msg_queue_rd[prio]];
+      if (!bolt_write((uint8_t*)msg, DPP_MSG_LEN(msg))) {
+        LOG_WARNING("BOLT queue full, %lu msg remain queued", msg_queue_cnt[MSG_PRIO_HIGH] + msg_queue_cnt[MSG_PRIO_LOW]);
+        return cnt;
+      }
+      uint32_t primask = __get_PRIMASK();
+      __disable_irq();
+      msg_queue_rd[prio] = (msg_queue_rd[prio] + 1) % MSG_POOL_SIZE;
+      msg_queue_cnt[prio]--;
+      __set_PRIMASK(primask);
+
+      uint32_t latency = (uint32_t)(local_clock_now() - msg_enqueue_time[msg - msg_pool]);
+      if (latency > msg_queue_stats.latency_max) {
+        msg_queue_stats.latency_max = latency;
+      }
+      msg_queue_stats.latency_sum += latency;
+      msg_queue_stats.written++;
+      msg_pool_release(msg);
+      cnt++;
+    }
+  }
+  return cnt;
+}
+
+
+/* prints the outbound message queue statistics (since boot) */
+void log_msg_queue_stats(void)
+{
+  uint32_t latency_avg = msg_queue_stats.written ? (uint32_t)(msg_queue_stats.latency_sum / msg_queue_stats.written) : 0;
+
+  LOG_INFO("msg queue: max. %lu queued  %lu written  %lu dropped  latency avg %lums max %lums", msg_queue_stats.queue_hwm, msg_queue_stats.written, msg_queue_stats.dropped,
+           (uint32_t)((uint64_t)latency_avg * 1000 / LPTIMER_SECOND), (uint32_t)((uint64_t)msg_queue_stats.latency_max * 1000 / LPTIMER_SECOND));
+}
+
+
 /* send a command with a 2-byte argument to the app processor */
 void generate_command(dpp_command_type_t cmd, uint16_t arg)
 {
-  msg_buffer.cmd.type     = cmd;
-  msg_buffer.cmd.arg16[0] = arg;
-  send_message(DPP_MSG_TYPE_CMD);
+  dpp_message_t* msg = msg_pool_acquire();
+
+  if (!msg) {
+    LOG_WARNING("msg dropped (no free message buffer)");
+    return;
+  }
+  msg->cmd.type     = cmd;
+  msg->cmd.arg16[0] = arg;
+  send_message(msg, DPP_MSG_TYPE_CMD);
 }
 
 
@@ -294,8 +574,7 @@ void generate_command(dpp_command_type_t cmd, uint16_t arg)
 
 bool schedule_command(uint32_t sched_time, dpp_command_type_t cmd_type, uint16_t arg)
 {
-  scheduled_cmd_t cmd;
-  uint32_t        t_now = get_time(0);
+  uint32_t t_now = get_time(0) / 1000000;
 
   if (sched_time < 86400) {   /* consider values < 1day as a relative offset */
     sched_time += t_now;
@@ -303,11 +582,23 @@ bool schedule_command(uint32_t sched_time, dpp_command_type_t cmd_type, uint16_t
     LOG_WARNING("scheduled time is in the past");   /* warn but still continue with scheduling -> command will be executed asap */
   }
 
-  cmd.scheduled_time = sched_time;
-  cmd.type           = cmd_type;
-  cmd.arg            = arg;
+  if (cmd_queue_add(cmd_type, arg, sched_time) == CMD_QUEUE_ID_INVALID) {
+    return false;
+  }
+  xTaskNotifyGive(xTaskHandle_helloworld);
+  return true;
+}
 
-  return list_insert(pending_commands, sched_time, &cmd);
+
+uint32_t get_next_command_time(void)
+{
+  const scheduled_cmd_t* next_cmd  = cmd_queue_peek();
+  uint32_t               next_time = config.bb_en.starttime;
+
+  if (next_cmd && ((next_time == 0) || (next_cmd->scheduled_time < next_time))) {
+    next_time = next_cmd->scheduled_time;
+  }
+  return next_time;
 }
 
 #endif /* BASEBOARD */
@@ -63,6 +63,8 @@
 /* External variables --------------------------------------------------------*/
 extern LPTIM_HandleTypeDef hlptim1;
 extern RTC_HandleTypeDef hrtc;
+extern DMA_HandleTypeDef hdma_spi1_rx;
+extern DMA_HandleTypeDef hdma_spi1_tx;
 extern SPI_HandleTypeDef hspi1;
 extern SPI_HandleTypeDef hspi2;
 extern TIM_HandleTypeDef htim2;
@@ -181,17 +183,31 @@ void DebugMon_Handler(void)
 /******************************************************************************/
 
 /**
-  * @brief This function handles EXTI line3 interrupt.
+  * @brief This function handles DMA1 channel2 global interrupt.
   */
-void EXTI3_IRQHandler(void)
+void DMA1_Channel2_IRQHandler(void)
 {
-  /* USER CODE BEGIN EXTI3_IRQn 0 */
+  /* USER CODE BEGIN DMA1_Channel2_IRQn 0 */
   ISR_ON_IND();
-  /* USER CODE END EXTI3_IRQn 0 */
-  HAL_GPIO_EXTI_IRQHandler(GPIO_PIN_3);
-  /* USER CODE BEGIN EXTI3_IRQn 1 */
+  /* USER CODE END DMA1_Channel2_IRQn 0 */
+  HAL_DMA_IRQHandler(&hdma_spi1_rx);
+  /* USER CODE BEGIN DMA1_Channel2_IRQn 1 */
   ISR_OFF_IND();
-  /* USER CODE END EXTI3_IRQn 1 */
+  /* USER CODE END DMA1_Channel2_IRQn 1 */
+}
+
+/**
+  * @brief This function handles DMA1 channel3 global interrupt.
+  */
+void DMA1_Channel3_IRQHandler(void)
+{
+  /* USER CODE BEGIN DMA1_Channel3_IRQn 0 */
+  ISR_ON_IND();
+  /* USER CODE END DMA1_Channel3_IRQn 0 */
+  HAL_DMA_IRQHandler(&hdma_spi1_tx);
+  /* USER CODE BEGIN DMA1_Channel3_IRQn 1 */
+  ISR_OFF_IND();
+  /* USER CODE END DMA1_Channel3_IRQn 1 */
 }
 
 /**
@@ -330,6 +346,9 @@ void LPTIM1_IRQHandler(void)
 {
   /* USER CODE BEGIN LPTIM1_IRQn 0 */
   ISR_ON_IND();
+  if (local_clock_handle_overflow()) {
+    HAL_LPTIM_AutoReloadMatchCallback(&hlptim1);    /* flag has already been cleared -> not called by the HAL handler */
+  }
   /* USER CODE END LPTIM1_IRQn 0 */
   HAL_LPTIM_IRQHandler(&hlptim1);
   /* USER CODE BEGIN LPTIM1_IRQn 1 */
@@ -339,6 +358,27 @@ void LPTIM1_IRQHandler(void)
 
 /* USER CODE BEGIN 1 */
 
+#if BOLT_IND_WAKEUP
+/**
+  * @brief This function handles EXTI line0 interrupt (BOLT_IND, only enabled if BOLT_IND_WAKEUP is set).
+  */
+void EXTI0_IRQHandler(void)
+{
+  ISR_ON_IND();
+  HAL_GPIO_EXTI_IRQHandler(GPIO_PIN_0);
+  ISR_OFF_IND();
+}
+#endif /* BOLT_IND_WAKEUP */
+
+/**
+  * @brief This function handles EXTI line3 interrupt (COM_TREQ, the pin is assigned to TIM2_CH4, the EXTI line is configured in the timesync task).
+  */
+void EXTI3_IRQHandler(void)
+{
+  ISR_ON_IND();
+  HAL_GPIO_EXTI_IRQHandler(GPIO_PIN_3);
+  ISR_OFF_IND();
+}
 
 /* USER CODE END 1 */
 /************************ (C) COPYRIGHT STMicroelectronics *****END OF FILE****/
@@ -39,15 +39,82 @@
 
 /* Global variables ----------------------------------------------------------*/
 
+extern TaskHandle_t xTaskHandle_bolt;
+
 
 /* Private define ------------------------------------------------------------*/
 
+#define BOLT_IND_MIN_INTERVAL_TICKS   ((uint64_t)BOLT_IND_MIN_INTERVAL_MS * LPTIMER_SECOND / 1000)
+
 
 /* Private variables and functions -------------------------------------------*/
 
+static uint8_t  bolt_read_buffer[BOLT_MAX_MSG_LEN];
+static uint32_t bolt_read_cnt = 0;                                         /* messages read since the last call to bolt_get_read_cnt() with reset */
+#if BOLT_IND_WAKEUP
+static volatile bool bolt_ind_wakeup       = false;                        /* set if the task was woken up by BOLT_IND */
+static uint64_t      bolt_ind_last         = 0;                            /* timestamp of the last BOLT_IND wakeup in lptimer ticks */
+static uint32_t      bolt_ind_deferred_cnt = 0;                            /* number of edges deferred due to the rate limit */
+#endif /* BOLT_IND_WAKEUP */
+
+
+#if BOLT_IND_WAKEUP
+
+/* reconfigures BOLT_IND (PA0) as rising edge interrupt */
+static void bolt_ind_init(void)
+{
+  GPIO_InitTypeDef GPIO_InitStruct = {0};
+
+  GPIO_InitStruct.Pin  = BOLT_IND_Pin;
+  GPIO_InitStruct.Mode = GPIO_MODE_IT_RISING;
+  GPIO_InitStruct.Pull = GPIO_NOPULL;
+  HAL_GPIO_Init(BOLT_IND_GPIO_Port, &GPIO_InitStruct);
+
+  HAL_NVIC_SetPriority(EXTI0_IRQn, 5, 0);
+  HAL_NVIC_EnableIRQ(EXTI0_IRQn);
+}
+
+#endif /* BOLT_IND_WAKEUP */
+
 
 /* Functions -----------------------------------------------------------------*/
 
+#if BOLT_IND_WAKEUP
+
+/* BOLT_IND rising edge */
+void GPIO_PIN_0_Callback(void)
+{
+  uint64_t now = local_clock_now();
+
+  /* ignore the edge if the pin is already low again, BOLT_IND stays high as long as there is data in the queue */
+  if (!BOLT_DATA_AVAILABLE) {
+    return;
+  }
+  /* rate limit: BOLT_IND is a level signal and there won't be another edge -> defer the wakeup to the end of the interval */
+  if (bolt_ind_last && ((now - bolt_ind_last) < BOLT_IND_MIN_INTERVAL_TICKS)) {
+    bolt_ind_deferred_cnt++;
+    helloworld_request_wakeup(bolt_ind_last + BOLT_IND_MIN_INTERVAL_TICKS);
+    return;
+  }
+  bolt_ind_last   = now;
+  bolt_ind_wakeup = true;
+  lpm_update_opmode(OP_MODE_EVT_WAKEUP);
+  vTaskNotifyGiveFromISR(xTaskHandle_bolt, 0);
+}
+
+#endif /* BOLT_IND_WAKEUP */
+
+
+uint32_t bolt_get_read_cnt(bool reset)
+{
+  uint32_t cnt = bolt_read_cnt;
+  if (reset) {
+    bolt_read_cnt = 0;
+  }
+  return cnt;
+}
+
+
 void task_bolt(void const * argument)
 {
   LOG_VERBOSE("bolt task started");
@@ -55,6 +122,10 @@ void task_bolt(void const * argument)
   /* empty the BOLT queue */
   bolt_flush();
 
+#if BOLT_IND_WAKEUP
+  bolt_ind_init();
+#endif /* BOLT_IND_WAKEUP */
+
   /* Infinite loop */
   for (;;)
   {
@@ -62,21 +133,57 @@ void task_bolt(void const * argument)
     ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
 
     /* read from BOLT */
-    static uint8_t  bolt_read_buffer[BOLT_MAX_MSG_LEN];
-    uint32_t max_read_cnt = BOLT_MAX_READ_COUNT;
-    /* only read as long as there is still space in the transmit queue */
-    while (max_read_cnt && BOLT_DATA_AVAILABLE) {
+    uint32_t read_cnt = 0;
+    while ((read_cnt < BOLT_MAX_READ_COUNT) && BOLT_DATA_AVAILABLE) {
+      TRACE_BEGIN(TRACE_ID_BOLT_READ);
       uint32_t len = bolt_read(bolt_read_buffer);
+      TRACE_END(TRACE_ID_BOLT_READ);
       if (!len) {
         LOG_ERROR("bolt read failed");
         break;
       }
-      process_message((dpp_message_t*)bolt_read_buffer, true);
-      max_read_cnt--;
+      read_cnt++;
+      /* the number of received bytes is only known here -> validate before processing */
+      if (validate_message((const dpp_message_t*)bolt_read_buffer, len)) {
+        TRACE_BEGIN(TRACE_ID_PROCESS_MSG);
+        process_validated_message((dpp_message_t*)bolt_read_buffer, true);
+        TRACE_END(TRACE_ID_PROCESS_MSG);
+      }
+    }
+    if (read_cnt) {
+      bolt_read_cnt += read_cnt;
+      LOG_VERBOSE("%lu msg read from BOLT", read_cnt);
+    }
+#if BOLT_IND_WAKEUP
+    /* more data than could be read in one go -> there won't be another BOLT_IND edge, read the rest after the min. interval */
+    if (BOLT_DATA_AVAILABLE) {
+      helloworld_request_wakeup(local_clock_now() + BOLT_IND_MIN_INTERVAL_TICKS);
+    }
+#endif /* BOLT_IND_WAKEUP */
+
+    /* write the queued outgoing messages to BOLT */
+    uint32_t write_cnt = send_queued_messages();
+    if (write_cnt) {
+      LOG_VERBOSE("%lu msg written to BOLT", write_cnt);
     }
-    if (max_read_cnt < BOLT_MAX_READ_COUNT) {
-      LOG_VERBOSE("%lu msg read from BOLT", BOLT_MAX_READ_COUNT - max_read_cnt);
+
+#if BOLT_IND_WAKEUP
+    if (bolt_ind_wakeup) {
+      bolt_ind_wakeup = false;
+      uint32_t primask = __get_PRIMASK();
+      __disable_irq();
+      uint32_t deferred_cnt = bolt_ind_deferred_cnt;
+      bolt_ind_deferred_cnt = 0;
+      __set_PRIMASK(primask);
+      if (deferred_cnt) {
+        LOG_VERBOSE("%lu BOLT_IND edges deferred", deferred_cnt);
+      }
+      /* woken up outside of the periodic round -> signal the LPM state machine that we are done (otherwise the hello world task does it) */
+      if (!helloworld_round_active()) {
+        lpm_update_opmode(OP_MODE_EVT_DONE);
+      }
     }
+#endif /* BOLT_IND_WAKEUP */
   }
 }
 
@@ -36,6 +36,8 @@
 #define NOTIFY_BS_TASK(val)           xTaskNotify(xTaskHandle_basestation, val, eSetValueWithOverwrite);
 #define NOTIFY_BS_TASK_FROM_ISR(val)  xTaskNotifyFromISR(xTaskHandle_basestation, val, eSetValueWithOverwrite, NULL)
 
+#define WAKEUP_MIN_DELAY_TICKS        (LPTIMER_SECOND / 100)    /* min. time between now and the next wakeup (10ms) */
+
 
 /* Variables */
 
@@ -43,9 +45,19 @@ extern TaskHandle_t  xTaskHandle_helloworld;
 extern TaskHandle_t  xTaskHandle_bolt;
 extern TaskHandle_t  xTaskHandle_timesync;
 
+static volatile bool round_active      = false;   /* set while a round of this task is in progress (until it signals OP_MODE_EVT_DONE) */
+static uint64_t      armed_wakeup      = 0;       /* timestamp the lptimer is currently armed for */
+static uint64_t      requested_wakeup  = 0;       /* earliest wakeup requested by other tasks (0 = none) */
+
 
 /* Functions */
 
+bool helloworld_round_active(void)
+{
+  return round_active;
+}
+
+
 void periodic_cb(void)
 {
   lpm_update_opmode(OP_MODE_EVT_WAKEUP);
@@ -53,23 +65,138 @@ void periodic_cb(void)
 }
 
 
+#if WAKEUP_PERIOD_ADAPTIVE
+
+/* returns the next wakeup period based on the BOLT traffic since the last call */
+static uint32_t adapt_wakeup_period(uint32_t period)
+{
+#if BOLT_ENABLE
+  uint32_t rx_cnt = bolt_get_read_cnt(true);
+#else
+  uint32_t rx_cnt = 0;
+#endif /* BOLT_ENABLE */
+
+  if (rx_cnt) {
+    period /= 2;
+  } else {
+    period += period / 4;
+  }
+  if (period < WAKEUP_PERIOD_MIN_S) {
+    period = WAKEUP_PERIOD_MIN_S;
+  } else if (period > WAKEUP_PERIOD_MAX_S) {
+    period = WAKEUP_PERIOD_MAX_S;
+  }
+  return period;
+}
+
+#endif /* WAKEUP_PERIOD_ADAPTIVE */
+
+
+/* arms the lptimer, must be called with interrupts disabled */
+static void arm_wakeup_timer(uint64_t timestamp)
+{
+  /* don't set the timer to a time in the past */
+  uint64_t t_min = local_clock_now() + WAKEUP_MIN_DELAY_TICKS;
+  if (timestamp < t_min) {
+    timestamp = t_min;
+  }
+  armed_wakeup = timestamp;
+  local_clock_set_alarm(timestamp, periodic_cb);
+}
+
+
+/* requests an additional (non-periodic) round of this task at the given local clock timestamp, can be called from an ISR */
+void helloworld_request_wakeup(uint64_t timestamp)
+{
+  uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+  if (!requested_wakeup || (timestamp < requested_wakeup)) {
+    requested_wakeup = timestamp;
+  }
+  if (timestamp < armed_wakeup) {
+    arm_wakeup_timer(timestamp);
+  }
+  __set_PRIMASK(primask);
+}
+
+
+/* arms the lptimer for the next periodic wakeup, the next scheduled command or the next requested wakeup, whichever comes first */
+static void set_wakeup_timer(uint64_t next_periodic_wakeup)
+{
+  uint64_t next_wakeup = next_periodic_wakeup;
+
+#if BASEBOARD
+  uint32_t next_cmd_time = get_next_command_time();
+  if (next_cmd_time) {
+    uint64_t cmd_wakeup = get_local_time((uint64_t)next_cmd_time * 1000000);
+    if (cmd_wakeup < next_wakeup) {
+      next_wakeup = cmd_wakeup;
+    }
+  }
+#endif /* BASEBOARD */
+
+  uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+  if (requested_wakeup && (requested_wakeup < next_wakeup)) {
+    next_wakeup = requested_wakeup;
+  }
+  arm_wakeup_timer(next_wakeup);
+  __set_PRIMASK(primask);
+}
+
+
 void task_helloworld(void const * argument)
 {
   LOG_VERBOSE("hello world task has started");
+  LOG_INFO("boot time: %lums", HAL_GetTick());    /* HAL tick starts counting in HAL_Init() */
 
   /* start the task in 1s */
-  lptimer_set(lptimer_now() + LPTIMER_S_TO_TICKS(1), periodic_cb);
+  uint64_t next_periodic_wakeup = local_clock_now() + LPTIMER_S_TO_TICKS(1);
+  uint32_t wakeup_period        = WAKEUP_PERIOD_S;
+  set_wakeup_timer(next_periodic_wakeup);
 
   for (;;)
   {
     /* wait until task gets unblocked */
     ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
-
-    uint32_t t_now = get_time(0) / 1000000;
-    LOG_VERBOSE("hello world! %lu", t_now);
-    led_on(LED_SYSTEM);
-    vTaskDelay(pdMS_TO_TICKS(100));
-    led_off(LED_SYSTEM);
+    round_active = true;
+
+    /* a requested wakeup is served by this round */
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    if (requested_wakeup && (local_clock_now() >= requested_wakeup)) {
+      requested_wakeup = 0;
+    }
+    __set_PRIMASK(primask);
+
+    /* the task is also woken up for scheduled commands and time requests -> only do the periodic work when it is due */
+    if (local_clock_now() >= next_periodic_wakeup) {
+      uint32_t t_now = get_time(0) / 1000000;
+      LOG_VERBOSE("hello world! %lu (+/-%luus)", t_now, get_time_uncertainty(0));
+      led_on(LED_SYSTEM);
+      vTaskDelay(pdMS_TO_TICKS(100));
+      led_off(LED_SYSTEM);
+
+#if WAKEUP_PERIOD_ADAPTIVE
+      wakeup_period = adapt_wakeup_period(wakeup_period);
+#endif /* WAKEUP_PERIOD_ADAPTIVE */
+      /* health metrics */
+      uint32_t cpu_dc = rtos_get_cpu_dc();
+      rtos_reset_cpu_dc();
+      LOG_INFO("wakeup period: %lus  cpu dc: %lu.%02lu%%", wakeup_period, cpu_dc / 100, cpu_dc % 100);
+#if LOG_TASK_STATS
+      rtos_log_task_stats();
+#endif /* LOG_TASK_STATS */
+      rtos_check_stack_usage();
+      log_command_stats();
+      LOG_INFO("msg pool: min. %lu of %u buffers free", msg_pool_get_free_min(), MSG_POOL_SIZE);
+      log_msg_queue_stats();
+#if TRACE_ENABLE
+      trace_dump();
+#endif /* TRACE_ENABLE */
+
+      next_periodic_wakeup = local_clock_now() + LPTIMER_S_TO_TICKS(wakeup_period);
+    }
 
 #if BASEBOARD
     /* execute pending baseboard commands */
@@ -77,7 +204,7 @@ void task_helloworld(void const * argument)
 #endif
 
     /* set a timer to trigger the next wakeup */
-    lptimer_set(lptimer_now() + LPTIMER_S_TO_TICKS(WAKEUP_PERIOD_S), periodic_cb);
+    set_wakeup_timer(next_periodic_wakeup);
 
     /* poll the BOLT and debug tasks */
     xTaskNotifyGive(xTaskHandle_bolt);
@@ -85,7 +212,7 @@ void task_helloworld(void const * argument)
     /* note: task will be interrupted at this point and resumes once the bolt and timesync tasks yield */
 
     /* signal the LPM state machine to go to STOP mode */
+    round_active = false;
     lpm_update_opmode(OP_MODE_EVT_DONE);
   }
 }
-
@@ -39,61 +39,150 @@
 
 extern TaskHandle_t      xTaskHandle_timesync;
 extern TaskHandle_t      xTaskHandle_helloworld;
+extern TIM_HandleTypeDef htim2;
 
 
 /* Private define ------------------------------------------------------------*/
 
+#define RATE_SHIFT            25                                              /* rate factor in Q7.25 format (us per lptimer tick) */
+#define RATE_NOMINAL          (uint32_t)((1000000ULL << RATE_SHIFT) / LPTIMER_SECOND)   /* rate factor without drift */
+
+_Static_assert((1000000ULL / LPTIMER_SECOND) < 127, "lptimer frequency too low for the Q7.25 rate factor");
+
 
 /* Private variables and functions -------------------------------------------*/
 
 static uint64_t unix_timestamp        = 0;        /* UNIX timestamp of the last sync point, in us */
 static uint64_t local_timestamp       = 0;        /* local timestamp of the last sync point, in timer ticks (source node: lptimer, base station: hs timer) */
 static uint64_t captured_timestamp    = 0;        /* captured timestamp of the last time request (COM_TREQ rising edge) in lptimer ticks -> only used on source nodes */
-static int32_t  average_drift_ppm     = 0;        /* average drift of the local timer towards the time master, in ppm */
+static uint32_t captured_offset_us    = 0;        /* time between captured_timestamp and the edge (sub-tick remainder), in us */
+static int32_t  drift_ppb             = 0;        /* estimated drift of the local timer towards the time master, in ppb */
+static uint32_t rate_factor           = RATE_NOMINAL;   /* drift compensated us per lptimer tick in Q7.25 format, updated with the drift */
+static uint32_t drift_error_ppb       = TIMESTAMP_MAX_DRIFT_PPM * 1000;   /* uncertainty of the drift compensation */
+static uint32_t sync_uncertainty_us   = 0;        /* uncertainty of the time at local_timestamp */
+static bool     time_set              = false;
 static bool     timestamp_updated     = false;
 static bool     timestamp_requested   = false;
+#if HOLDOVER_ENABLE
+static uint64_t last_sync_timestamp   = 0;        /* local timestamp of the last received sync point */
+static uint64_t last_temp_timestamp   = 0;
+static bool     holdover              = false;
+#endif /* HOLDOVER_ENABLE */
 
 
 /* Functions -----------------------------------------------------------------*/
 
-static void update_time(void)
+/* converts lptimer ticks to us with the current rate factor (the 64x32 bit multiplication is split into two 32x32 bit multiplications) */
+static uint64_t ticks_to_us(uint64_t ticks)
 {
-  static uint64_t prev_local_timestamp = 0;
-  static uint64_t prev_unix_timestamp  = 0;
+  return (((uint64_t)(uint32_t)ticks * rate_factor) >> RATE_SHIFT) + (((ticks >> 32) * rate_factor) << (32 - RATE_SHIFT));
+}
 
-  if (timestamp_updated) {
-    /* calculate the drift */
-    if (prev_unix_timestamp) {
-      int64_t master_ts_diff_us = (unix_timestamp - prev_unix_timestamp);
-      int64_t local_ts_diff_us  = ((uint64_t)(local_timestamp - prev_local_timestamp) * 1000000 / LPTIMER_SECOND);
-      int32_t drift_ppm         = (int64_t)(local_ts_diff_us - master_ts_diff_us) * 1000000 / master_ts_diff_us;
-      /* drift has to be within a certain range */
-      if (drift_ppm < TIMESTAMP_MAX_DRIFT_PPM && drift_ppm > -TIMESTAMP_MAX_DRIFT_PPM) {
-        if (drift_ppm > TIMESTAMP_TYPICAL_DRIFT_PPM || drift_ppm < -TIMESTAMP_TYPICAL_DRIFT_PPM) {
-          LOG_WARNING("drift is larger than usual");
-        }
-        if (average_drift_ppm == 0) {
-          average_drift_ppm = drift_ppm;
-        } else {
-          average_drift_ppm = (average_drift_ppm + drift_ppm) / 2;
-        }
-        /* make sure the drift does not exceed the maximum allowed value */
-        if (average_drift_ppm > TIMESTAMP_MAX_DRIFT_PPM) {
-          average_drift_ppm = TIMESTAMP_MAX_DRIFT_PPM;
-        } else if (average_drift_ppm < -TIMESTAMP_MAX_DRIFT_PPM) {
-          average_drift_ppm = -TIMESTAMP_MAX_DRIFT_PPM;
-        }
-        /* note: a negative drift means the local time runs slower than the master clock */
-        LOG_VERBOSE("current drift: %ldppm   average drift: %ldppm", drift_ppm, average_drift_ppm);
 
-      } else {
-        LOG_WARNING("drift is too large (%ldppm)", drift_ppm);
-      }
+/* inverse of ticks_to_us(), rounded up */
+static uint64_t us_to_ticks(uint64_t us)
+{
+  return (us / rate_factor << RATE_SHIFT) + (((us % rate_factor) << RATE_SHIFT) + rate_factor - 1) / rate_factor;
+}
+
+
+/* COM_TREQ (PA3) is assigned to TIM2_CH4 (see MX_TIM2_Init), the EXTI line still sees the edge and is configured here */
+static void treq_init(void)
+{
+  __HAL_RCC_SYSCFG_CLK_ENABLE();
+  MODIFY_REG(SYSCFG->EXTICR[0], SYSCFG_EXTICR1_EXTI3, SYSCFG_EXTICR1_EXTI3_PA);
+  SET_BIT(EXTI->RTSR1, COM_TREQ_Pin);
+  CLEAR_BIT(EXTI->FTSR1, COM_TREQ_Pin);
+  SET_BIT(EXTI->IMR1, COM_TREQ_Pin);
+  HAL_NVIC_SetPriority(EXTI3_IRQn, 5, 0);
+  HAL_NVIC_EnableIRQ(EXTI3_IRQn);
+
+#if TIMESYNC_TREQ_HW_CAPTURE
+  if (HAL_TIM_IC_Start(&htim2, TIM_CHANNEL_4) != HAL_OK) {
+    LOG_ERROR("failed to start TREQ input capture");
+  }
+#endif /* TIMESYNC_TREQ_HW_CAPTURE */
+}
+
+
+/* returns the lptimer timestamp of the last COM_TREQ rising edge and the time between this timestamp and the edge in us, must be called from the EXTI callback */
+static uint64_t treq_get_timestamp(uint32_t* offset_us)
+{
+#if TIMESYNC_TREQ_LATENCY_TEST_US
+  delay_us(__HAL_TIM_GET_COUNTER(&htim2) % TIMESYNC_TREQ_LATENCY_TEST_US);
+#endif /* TIMESYNC_TREQ_LATENCY_TEST_US */
+
+  uint64_t now = local_clock_now();
+
+  *offset_us = 0;
+
+#if TIMESYNC_TREQ_HW_CAPTURE
+  /* the capture flag is only set if TIM2 was running when the edge occurred (i.e. not in STOP2)
+   * note: LPTIM1 keeps running in STOP2 but has no input capture on the STM32L4, the EXTI timestamp is the only option in that case */
+  if (__HAL_TIM_GET_FLAG(&htim2, TIM_FLAG_CC4)) {
+    uint32_t capture = HAL_TIM_ReadCapturedValue(&htim2, TIM_CHANNEL_4);    /* reading CCR4 clears the flag */
+    uint32_t hs_cnt, lp_cnt, lp_tick;
+    __HAL_TIM_CLEAR_FLAG(&htim2, TIM_FLAG_CC4OF);
+
+    /* the lptimer counter runs asynchronously to the APB clock, only use values confirmed by a second read */
+    do {
+      lp_cnt = LPTIM1->CNT;
+    } while (lp_cnt != LPTIM1->CNT);
+
+    /* wait for the next lptimer tick (at most ~30.5us) to get a sync point between the hs timer and the lptimer */
+    do {
+      hs_cnt  = __HAL_TIM_GET_COUNTER(&htim2);
+      lp_tick = LPTIM1->CNT;
+    } while ((lp_tick == lp_cnt) || (lp_tick != LPTIM1->CNT));
+
+    /* extend the counter value of the tick boundary to 64 bits */
+    uint64_t sync     = local_clock_now();
+    uint64_t boundary = sync - ((sync - lp_tick) & 0xffff);
+
+    /* the time elapsed since the edge is known with hs timer resolution -> independent of the interrupt latency */
+    uint64_t elapsed  = (uint64_t)(hs_cnt - capture) * LPTIMER_SECOND;       /* in 1 / (HS_TIMER_FREQUENCY * LPTIMER_SECOND) s */
+    uint64_t ticks    = (elapsed + HS_TIMER_FREQUENCY - 1) / HS_TIMER_FREQUENCY;   /* rounded up -> the returned timestamp is at or before the edge */
+    uint64_t captured = boundary - ticks;
+    *offset_us        = ((ticks * HS_TIMER_FREQUENCY - elapsed) * 1000000 + (uint64_t)HS_TIMER_FREQUENCY * LPTIMER_SECOND / 2) / ((uint64_t)HS_TIMER_FREQUENCY * LPTIMER_SECOND);
+  #if TIMESYNC_TREQ_LATENCY_TEST_US
+    LOG_INFO("TREQ latency %luus, sw capture error %ld ticks", (uint32_t)((uint64_t)(hs_cnt - capture) * 1000000 / HS_TIMER_FREQUENCY), (int32_t)(now - 1 - captured));
+  #endif /* TIMESYNC_TREQ_LATENCY_TEST_US */
+    return captured;
+  }
+#endif /* TIMESYNC_TREQ_HW_CAPTURE */
+
+  return now - 1;   /* subtract wakeup + ISR + function call delays (measured to ~20us) */
+}
+
+
+static void set_drift(int32_t ppb)
+{
+  drift_ppb   = ppb;
+  rate_factor = ((uint64_t)RATE_NOMINAL * (1000000000LL - drift_ppb) + 500000000) / 1000000000;
+}
+
+
+static void update_time(void)
+{
+  if (timestamp_updated) {
+    if (drift_estimator_add_sample(local_timestamp, unix_timestamp)) {
+      /* note: a negative drift means the local time runs slower than the master clock */
+      set_drift(drift_estimator_get_drift_ppb());
+      drift_error_ppb = TIMESYNC_DRIFT_ERROR_PPB;
+#if HOLDOVER_ENABLE
+      drift_estimator_learn_temp(temp_sensor_read(), drift_ppb);
+#endif /* HOLDOVER_ENABLE */
+    }
+    sync_uncertainty_us = TIMESYNC_SYNC_ERROR_US;
+    time_set            = true;
+#if HOLDOVER_ENABLE
+    last_sync_timestamp = local_timestamp;
+    if (holdover) {
+      holdover = false;
+      LOG_INFO("holdover mode left");
     }
+#endif /* HOLDOVER_ENABLE */
     LOG_VERBOSE("time updated");
-
-    prev_local_timestamp = local_timestamp;
-    prev_unix_timestamp  = unix_timestamp;
   }
   timestamp_updated   = false;
   timestamp_requested = false;
@@ -104,10 +193,14 @@ static void update_time(void)
 void set_time(uint64_t unix_time_us)
 {
   if (timestamp_requested) {
-    unix_timestamp      = unix_time_us;
+    /* get_time() and the holdover may interrupt or be interrupted by this function -> update the sync point atomically */
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    unix_timestamp      = unix_time_us - captured_offset_us;
     local_timestamp     = captured_timestamp;
     timestamp_requested = false;
     timestamp_updated   = true;
+    __set_PRIMASK(primask);
 
     if (!IS_INTERRUPT()) {
       xTaskNotifyGive(xTaskHandle_timesync);
@@ -121,17 +214,93 @@ void set_time(uint64_t unix_time_us)
 uint64_t get_time(uint64_t at_time)
 {
   if (at_time == 0) {
-    at_time = lptimer_now();
+    at_time = local_clock_now();
+  }
+  if (at_time >= local_timestamp) {
+    return unix_timestamp + ticks_to_us(at_time - local_timestamp);
+  }
+  return unix_timestamp - ticks_to_us(local_timestamp - at_time);
+}
+
+
+uint32_t get_time_uncertainty(uint64_t at_time)
+{
+  if (!time_set) {
+    return UINT32_MAX;
+  }
+  if (at_time == 0) {
+    at_time = local_clock_now();
+  }
+  uint64_t elapsed_us  = ticks_to_us((at_time >= local_timestamp) ? (at_time - local_timestamp) : (local_timestamp - at_time));
+  uint64_t uncertainty = sync_uncertainty_us + elapsed_us * drift_error_ppb / 1000000000;
+
+  return (uncertainty < UINT32_MAX) ? uncertainty : UINT32_MAX;
+}
+
+
+/* inverse of get_time(), rounded up to the next tick */
+uint64_t get_local_time(uint64_t unix_time_us)
+{
+  if (unix_time_us >= unix_timestamp) {
+    return local_timestamp + us_to_ticks(unix_time_us - unix_timestamp);
   }
-  return unix_timestamp + (((int64_t)at_time - (int64_t)local_timestamp) * (1000000LL - average_drift_ppm) / LPTIMER_SECOND);
+  return local_timestamp - us_to_ticks(unix_timestamp - unix_time_us);
 }
 
 
+#if HOLDOVER_ENABLE
+
+/* predicts the drift from the MCU temperature if no sync point has been received within HOLDOVER_TIMEOUT_S */
+static void update_holdover(void)
+{
+  uint64_t now = local_clock_now();
+  int32_t  temp, predicted_ppb;
+  bool     learned;
+
+  if (!time_set || (LPTIMER_TICKS_TO_S(now - last_sync_timestamp) < HOLDOVER_TIMEOUT_S)) {
+    return;
+  }
+  if (!holdover) {
+    holdover = true;
+    LOG_WARNING("no sync point received for %lus, entering holdover mode", (uint32_t)LPTIMER_TICKS_TO_S(now - last_sync_timestamp));
+  } else if (LPTIMER_TICKS_TO_S(now - last_temp_timestamp) < HOLDOVER_TEMP_INTERVAL_S) {
+    return;
+  }
+  last_temp_timestamp = now;
+
+  temp    = temp_sensor_read();
+  learned = drift_estimator_predict(temp, &predicted_ppb);
+  if (!learned) {
+    predicted_ppb = drift_ppb;      /* keep the last estimate */
+  }
+
+  /* move the sync point to the current time before the drift is changed to keep the time continuous */
+  uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+  if (!timestamp_updated) {
+    sync_uncertainty_us = get_time_uncertainty(now);
+    unix_timestamp      = get_time(now);
+    local_timestamp     = now;
+    drift_error_ppb     = learned ? TIMESYNC_DRIFT_ERROR_PPB : (TIMESTAMP_MAX_DRIFT_PPM * 1000);
+    set_drift(predicted_ppb);
+  }
+  __set_PRIMASK(primask);
+
+  LOG_INFO("holdover: temperature %ldC  drift %ldppb  uncertainty %luus", temp, predicted_ppb, sync_uncertainty_us);
+}
+
+#endif /* HOLDOVER_ENABLE */
+
+
 void GPIO_PIN_3_Callback(void)
 {
+  uint32_t offset_us;
+  uint64_t timestamp = treq_get_timestamp(&offset_us);   /* always read to clear a pending capture */
+
   if (!timestamp_requested) {
     /* only overwrite if there is not already a pending timestamp request */
-    captured_timestamp  = lptimer_now() - 1;   /* subtract wakeup + ISR + function call delays (measured to ~20us) */
+    captured_timestamp  = timestamp;
+    captured_offset_us  = offset_us;
     timestamp_requested = true;
   }
   lpm_update_opmode(OP_MODE_EVT_WAKEUP);
@@ -144,12 +313,19 @@ void task_timesync(void const * argument)
 {
   LOG_VERBOSE("timesync task started");
 
+  treq_init();
+
   /* Infinite loop */
   for (;;)
   {
     /* wait for notification token (= explicitly granted permission to run) */
     ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    TRACE_BEGIN(TRACE_ID_UPDATE_TIME);
     update_time();
+    TRACE_END(TRACE_ID_UPDATE_TIME);
+#if HOLDOVER_ENABLE
+    update_holdover();
+#endif /* HOLDOVER_ENABLE */
 
 #if BASEBOARD_TREQ_WATCHDOG && BASEBOARD
     static uint64_t last_treq = 0;
@@ -161,8 +337,8 @@ void task_timesync(void const * argument)
     if (BASEBOARD_IS_ENABLED()) {
 
       /* check when was the last time we got a time request */
-      if (LPTIMER_TICKS_TO_S(lptimer_now() - last_treq) > BASEBOARD_TREQ_WATCHDOG) {
-        last_treq = lptimer_now();
+      if (LPTIMER_TICKS_TO_S(local_clock_now() - last_treq) > BASEBOARD_TREQ_WATCHDOG) {
+        last_treq = local_clock_now();
 
         /* power cycle the baseboard */
         LOG_WARNING("power-cycling baseboard (TREQ watchdog)");
@@ -177,7 +353,7 @@ void task_timesync(void const * argument)
         }
       }
     } else {
-      last_treq = lptimer_now();
+      last_treq = local_clock_now();
     }
 #endif /* BASEBOARD_TREQ_WATCHDOG */
   }
@@ -0,0 +1,134 @@
+/*
+ * Copyright (c) 2022, ETH Zurich, Computer Engineering Group (TEC)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * MCU internal temperature sensor
+ *
+ * ADC1 is configured with the LL driver on each measurement and put back into
+ * deep power-down mode afterwards. ADC1 is enabled in the .ioc with the LL
+ * driver (VREFINT and temperature sensor channels) so that CubeMX provides the
+ * LL ADC driver, but the call to MX_ADC1_Init() is not generated.
+ * The internal reference voltage is measured first to compensate for VDDA.
+ * All waits on the ADC are bounded by TEMP_SENSOR_TIMEOUT_US. On a timeout,
+ * the ADC is powered down and TEMP_SENSOR_INVALID is returned.
+ */
+
+#include "main.h"
+#include "stm32l4xx_ll_adc.h"
+
+
+/* Private define ------------------------------------------------------------*/
+
+#define TEMP_SENSOR_ADC       ADC1
+#define TEMP_SENSOR_SMP       LL_ADC_SAMPLINGTIME_640CYCLES_5     /* the temperature sensor requires a sampling time of at least 5us */
+#define TEMP_SENSOR_TIMEOUT_US  1000                              /* max. time to wait for an ADC flag (a conversion takes ~40us) */
+
+
+/* Functions -----------------------------------------------------------------*/
+
+/* waits until the given ADC flag has the given state, returns false on a timeout */
+static bool wait_flag(uint32_t (*get_flag)(ADC_TypeDef*), uint32_t state)
+{
+  uint32_t timeout = TEMP_SENSOR_TIMEOUT_US;
+  while (get_flag(TEMP_SENSOR_ADC) != state) {
+    if (!timeout--) {
+      return false;
+    }
+    delay_us(1);
+  }
+  return true;
+}
+
+
+static bool convert(uint32_t channel, uint32_t* out_raw)
+{
+  LL_ADC_REG_SetSequencerRanks(TEMP_SENSOR_ADC, LL_ADC_REG_RANK_1, channel);
+  LL_ADC_REG_StartConversion(TEMP_SENSOR_ADC);
+  if (!wait_flag(LL_ADC_IsActiveFlag_EOC, 1)) {
+    return false;
+  }
+  *out_raw = LL_ADC_REG_ReadConversionData12(TEMP_SENSOR_ADC);    /* also clears the EOC flag */
+  return true;
+}
+
+
+int32_t temp_sensor_read(void)
+{
+  uint32_t vref_raw = 0, temp_raw = 0, vdda_mv;
+  bool     success;
+
+  /* power up */
+  __HAL_RCC_ADC_CLK_ENABLE();
+  LL_ADC_SetCommonClock(__LL_ADC_COMMON_INSTANCE(TEMP_SENSOR_ADC), LL_ADC_CLOCK_SYNC_PCLK_DIV4);
+  LL_ADC_SetCommonPathInternalCh(__LL_ADC_COMMON_INSTANCE(TEMP_SENSOR_ADC), LL_ADC_PATH_INTERNAL_VREFINT | LL_ADC_PATH_INTERNAL_TEMPSENSOR);
+  LL_ADC_DisableDeepPowerDown(TEMP_SENSOR_ADC);
+  LL_ADC_EnableInternalRegulator(TEMP_SENSOR_ADC);
+  delay_us(LL_ADC_DELAY_TEMPSENSOR_STAB_US);      /* also covers the regulator startup time */
+
+  LL_ADC_StartCalibration(TEMP_SENSOR_ADC, LL_ADC_SINGLE_ENDED);
+  success = wait_flag(LL_ADC_IsCalibrationOnGoing, 0);
+  if (success) {
+    delay_us(1);                                  /* min. delay between calibration and enable (LL_ADC_DELAY_CALIB_ENABLE_ADC_CYCLES) */
+    LL_ADC_ClearFlag_ADRDY(TEMP_SENSOR_ADC);
+    LL_ADC_Enable(TEMP_SENSOR_ADC);
+    success = wait_flag(LL_ADC_IsActiveFlag_ADRDY, 1);
+  }
+
+  /* measure */
+  if (success) {
+    LL_ADC_REG_SetSequencerLength(TEMP_SENSOR_ADC, LL_ADC_REG_SEQ_SCAN_DISABLE);
+    LL_ADC_SetChannelSamplingTime(TEMP_SENSOR_ADC, LL_ADC_CHANNEL_VREFINT, TEMP_SENSOR_SMP);
+    LL_ADC_SetChannelSamplingTime(TEMP_SENSOR_ADC, LL_ADC_CHANNEL_TEMPSENSOR, TEMP_SENSOR_SMP);
+    success = convert(LL_ADC_CHANNEL_VREFINT, &vref_raw) &&
+              convert(LL_ADC_CHANNEL_TEMPSENSOR, &temp_raw) &&
+              (vref_raw != 0);
+  }
+
+  /* power down (also after a timeout) */
+  if (LL_ADC_REG_IsConversionOngoing(TEMP_SENSOR_ADC)) {
+    LL_ADC_REG_StopConversion(TEMP_SENSOR_ADC);
+    wait_flag(LL_ADC_REG_IsStopConversionOngoing, 0);
+  }
+  if (LL_ADC_IsEnabled(TEMP_SENSOR_ADC)) {
+    LL_ADC_Disable(TEMP_SENSOR_ADC);
+    success = wait_flag(LL_ADC_IsEnabled, 0) && success;
+  }
+  LL_ADC_SetCommonPathInternalCh(__LL_ADC_COMMON_INSTANCE(TEMP_SENSOR_ADC), LL_ADC_PATH_INTERNAL_NONE);
+  LL_ADC_DisableInternalRegulator(TEMP_SENSOR_ADC);
+  LL_ADC_EnableDeepPowerDown(TEMP_SENSOR_ADC);
+  __HAL_RCC_ADC_CLK_DISABLE();
+
+  if (!success) {
+    LOG_WARNING("temperature sensor: ADC timeout");
+    return TEMP_SENSOR_INVALID;
+  }
+  vdda_mv = __LL_ADC_CALC_VREFANALOG_VOLTAGE(vref_raw, LL_ADC_RESOLUTION_12B);
+  return __LL_ADC_CALC_TEMPERATURE(vdda_mv, temp_raw, LL_ADC_RESOLUTION_12B);
+}
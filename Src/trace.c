@@ -0,0 +1,103 @@
+/*
+ * Copyright (c) 2022, ETH Zurich, Computer Engineering Group (TEC)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * lightweight tracepoints
+ *
+ * Each tracepoint stores its ID, the type (begin / end) and the DWT cycle
+ * counter in a RAM ring buffer. The oldest entries are overwritten when the
+ * buffer is full. trace_dump() prints the entries over the log, they can be
+ * decoded into latency histograms with tools/trace_decode.py.
+ * Note: the cycle counter does not run in STOP mode, only begin / end pairs
+ * without a low-power phase in between give valid durations.
+ * Recording is suspended while the buffer is dumped, otherwise the ISRs of the
+ * log output would overwrite the entries that are being printed.
+ */
+
+#include "main.h"
+
+
+#if TRACE_ENABLE
+
+/* Private typedefs ----------------------------------------------------------*/
+
+typedef struct {
+  uint32_t cycles;
+  uint8_t  id;
+  uint8_t  type;
+} trace_entry_t;
+
+
+/* Private variables ---------------------------------------------------------*/
+
+static trace_entry_t trace_buffer[TRACE_BUFFER_SIZE];
+static uint32_t      trace_wr_idx    = 0;     /* total number of recorded entries */
+static uint32_t      trace_rd_idx    = 0;
+static volatile bool trace_suspended = false; /* no recording while the buffer is dumped */
+
+
+/* Functions -----------------------------------------------------------------*/
+
+void trace_record(uint32_t id, uint32_t type)
+{
+  if (trace_suspended) {
+    return;
+  }
+  uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+  trace_entry_t* entry = &trace_buffer[trace_wr_idx & (TRACE_BUFFER_SIZE - 1)];
+  trace_wr_idx++;
+  entry->cycles = CYCLE_COUNTER_VALUE();
+  entry->id     = id;
+  entry->type   = type;
+  __set_PRIMASK(primask);
+}
+
+
+void trace_dump(void)
+{
+  trace_suspended = true;
+  uint32_t wr_idx = trace_wr_idx;
+
+  /* entries that have been overwritten are lost */
+  if ((wr_idx - trace_rd_idx) > TRACE_BUFFER_SIZE) {
+    LOG_WARNING("%lu trace entries lost", wr_idx - trace_rd_idx - TRACE_BUFFER_SIZE);
+    trace_rd_idx = wr_idx - TRACE_BUFFER_SIZE;
+  }
+  LOG_RAW("TRC clk %lu" LOG_NEWLINE, SystemCoreClock);
+  while (trace_rd_idx != wr_idx) {
+    const trace_entry_t* entry = &trace_buffer[trace_rd_idx & (TRACE_BUFFER_SIZE - 1)];
+    LOG_RAW("TRC %02x %u %08lx" LOG_NEWLINE, entry->id, entry->type, entry->cycles);
+    trace_rd_idx++;
+  }
+  trace_suspended = false;
+}
+
+#endif /* TRACE_ENABLE */
@@ -0,0 +1,103 @@
+#!/usr/bin/env python3
+#
+# Copyright (c) 2022, ETH Zurich, Computer Engineering Group (TEC)
+# All rights reserved.
+#
+# decodes the trace entries printed by trace_dump() and prints a latency histogram per tracepoint
+#
+# usage: trace_decode.py [logfile]   (reads from stdin if no file is given)
+#
+
+import re
+import sys
+from collections import defaultdict
+
+# keep in sync with trace_id_t in Inc/trace.h
+TRACE_IDS = {
+    1: "process_msg",
+    2: "send_msg",
+    3: "bolt_read",
+    4: "update_time",
+}
+TRACE_ID_ISR_BASE = 16
+
+ISR_NAMES = {
+    3:  "HardFault",
+    15: "SysTick",
+    16 + 9:  "EXTI3",
+    16 + 12: "DMA1_Ch2",
+    16 + 13: "DMA1_Ch3",
+    16 + 14: "DMA1_Ch4",
+    16 + 15: "DMA1_Ch5",
+    16 + 25: "TIM1_UP_TIM16",
+    16 + 28: "TIM2",
+    16 + 35: "SPI1",
+    16 + 36: "SPI2",
+    16 + 37: "USART1",
+    16 + 40: "EXTI15_10",
+    16 + 41: "RTC_Alarm",
+    16 + 65: "LPTIM1",
+    16 + 6:  "EXTI0",
+}
+
+ENTRY_REGEX = re.compile(r"TRC ([0-9a-fA-F]{2}) ([01]) ([0-9a-fA-F]{8})")
+CLOCK_REGEX = re.compile(r"TRC clk (\d+)")
+
+
+def tracepoint_name(trace_id):
+    if trace_id >= TRACE_ID_ISR_BASE:
+        exc = trace_id - TRACE_ID_ISR_BASE
+        return "ISR " + ISR_NAMES.get(exc, "#%d" % exc)
+    return TRACE_IDS.get(trace_id, "id %d" % trace_id)
+
+
+def print_histogram(name, durations_us):
+    durations_us.sort()
+    cnt = len(durations_us)
+    print("%s: %d samples, min %.1fus, median %.1fus, max %.1fus" %
+          (name, cnt, durations_us[0], durations_us[cnt // 2], durations_us[-1]))
+    # logarithmic bins: [0, 1), [1, 2), [2, 4), ...
+    bins = defaultdict(int)
+    for d in durations_us:
+        bins[int(d).bit_length()] += 1
+    max_cnt = max(bins.values())
+    for b in sorted(bins):
+        lower = 0 if b == 0 else 1 << (b - 1)
+        upper = 1 << b
+        bar = "#" * max(1, bins[b] * 50 // max_cnt)
+        print("  %7dus - %7dus %6d %s" % (lower, upper, bins[b], bar))
+    print("")
+
+
+def main():
+    infile = open(sys.argv[1]) if len(sys.argv) > 1 else sys.stdin
+    clock_mhz = None
+    begin = {}
+    durations = defaultdict(list)
+
+    for line in infile:
+        m = CLOCK_REGEX.search(line)
+        if m:
+            clock_mhz = int(m.group(1)) / 1e6
+            begin.clear()       # the cycle counter may have stopped in between two dumps
+            continue
+        m = ENTRY_REGEX.search(line)
+        if not m or not clock_mhz:
+            continue
+        trace_id = int(m.group(1), 16)
+        cycles = int(m.group(3), 16)
+        if m.group(2) == "0":
+            begin[trace_id] = cycles
+        elif trace_id in begin:
+            diff = (cycles - begin.pop(trace_id)) & 0xffffffff
+            durations[trace_id].append(diff / clock_mhz)
+
+    if not durations:
+        print("no trace entries found")
+        return
+    for trace_id in sorted(durations):
+        print_histogram(tracepoint_name(trace_id), durations[trace_id])
+
+
+if __name__ == "__main__":
+    main()